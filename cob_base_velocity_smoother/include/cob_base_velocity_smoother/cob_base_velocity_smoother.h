@@ -23,7 +23,11 @@
 // standard includes
 #include <XmlRpc.h>
 #include <pthread.h>
+#include <algorithm>
+#include <cmath>
 #include <deque>
+#include <limits>
+#include <vector>
 #include <sstream>
 #include <iostream>
 #include <boost/circular_buffer.hpp>
@@ -43,6 +47,89 @@
  * of past messages and limiting the acceleration under a given threshold.
  * cob_base_velocity_smoother subsribes (input) and publishes (output) geometry_msgs::Twist.
  ****************************************************************/
+
+// running sum and sliding extremes of one velocity component over the messages stored in the ring buffer
+// values are inserted as newest and evicted as oldest message, both in amortized constant time
+class WindowAxisStatistics
+{
+public:
+  WindowAxisStatistics();
+
+  // capacity of the circular buffer, bounds the number of extreme candidates
+  void setCapacity(unsigned int capacity);
+  void clear();
+
+  // insert the value of the newest message
+  void push(double value);
+  // evict the value of the oldest message
+  void pop(double value);
+
+  // true if all stored values are zero
+  bool isZero() const;
+  // mean over the stored values and the given number of zeros older than all of them,
+  // without the value deviating most from the plain mean
+  double getMean(unsigned int zeros) const;
+
+private:
+  struct Candidate
+  {
+    double value;
+    long sequence;
+  };
+
+  double sum_;
+  unsigned long nonzero_;
+  // sequence number of the next inserted and of the oldest stored value
+  long head_, tail_;
+  // candidates for max and min, oldest first; of equal values only the newest is kept
+  boost::circular_buffer<Candidate> max_, min_;
+};
+
+// ring buffer of the received velocities (linear/x, linear/y, angular/z) and their timestamps,
+// stored as separate arrays, newest message first
+// refilling with zero messages only sets a count of zeros that are older than all stored messages
+class VelocityRingBuffer
+{
+public:
+  VelocityRingBuffer();
+
+  void setCapacity(unsigned int capacity);
+  unsigned int size() const;
+  bool empty() const;
+  bool full() const;
+
+  // replace the content by zero messages with the given timestamp
+  void fillWithZeros(ros::Time stamp);
+  // insert as newest message, evicting the oldest one if the buffer is full
+  void push(ros::Time stamp, double vx, double vy, double vtheta);
+  // evict all messages with a timestamp not later than the watermark
+  void expire(ros::Time watermark);
+
+  // timestamp of the message with the given age (0 is the newest)
+  ros::Time getStamp(unsigned int age) const;
+  // true if all messages are zero
+  bool isZero() const;
+
+  // mean values for linear/x, linear/y and angular/z
+  double meanValueX() const;
+  double meanValueY() const;
+  double meanValueZ() const;
+
+private:
+  void popOldest();
+
+  unsigned int capacity_;
+  // index of the next insertion and number of stored messages
+  unsigned int head_, count_;
+  std::vector<double> vx_, vy_, vtheta_;
+  std::vector<ros::Time> stamp_;
+  // number and timestamp of the zero messages older than the stored ones
+  unsigned int zeros_;
+  ros::Time zero_stamp_;
+
+  WindowAxisStatistics stats_x_, stats_y_, stats_z_;
+};
+
 class cob_base_velocity_smoother
 {
 private:
@@ -70,6 +157,38 @@ private:
   void set_new_msg_received(bool received);
   bool get_new_msg_received();
 
+  // one shot timer for steps without a new message (deferred message, stop sequence, timeout)
+  ros::Timer step_timer_;
+  // time of the last calculation step and of the last received message
+  ros::Time last_step_, last_msg_time_;
+  // no step is scheduled as the buffer and the output are zero
+  bool idle_;
+  // last published message
+  geometry_msgs::Twist last_published_;
+  bool published_;
+
+  // timing of the calculation steps, reported every timing_report_period_ seconds (0 disables)
+  struct StepTiming
+  {
+    unsigned int steps, wakeups, publishes;
+    // wall time of setOutput [s]
+    double compute_sum, compute_max;
+    // delay of timer steps behind their schedule [s]
+    double wakeup_sum, wakeup_max;
+    // wall time between published messages [s]
+    double interval_min, interval_max;
+  };
+  StepTiming timing_;
+  double timing_report_period_;
+  ros::WallTime last_publish_wall_, last_report_wall_;
+
+  // true if all stored messages and the last output are zero, so further steps would not change anything
+  bool isSettled();
+  // arm the step timer for the next step that is required without a new message
+  void scheduleNextStep(ros::Time now);
+  void stepTimerCallback(const ros::TimerEvent& event);
+  void reportTiming(ros::WallTime now);
+
 public:
   // constructor
   cob_base_velocity_smoother();
@@ -80,10 +199,11 @@ public:
   //create node handle
   ros::NodeHandle nh_, pnh_;
 
-  //circular buffers for velocity, output and time
-  boost::circular_buffer<geometry_msgs::Twist> cb_;
-  boost::circular_buffer<geometry_msgs::Twist> cb_out_;
-  boost::circular_buffer<ros::Time> cb_time_;
+  //ring buffer for velocity and time
+  VelocityRingBuffer buffer_;
+  //last output, used for limiting the acceleration
+  geometry_msgs::Twist last_output_;
+  bool has_output_;
 
   // declaration of ros subscribers
   ros::Subscriber geometry_msgs_sub_;
@@ -93,7 +213,7 @@ public:
 
   //callback function to subsribe to the geometry messages
   void geometryCallback(const geometry_msgs::Twist::ConstPtr &cmd_vel);
-  //calculation function called periodically in main
+  //calculation function called for new messages and by the step timer
   void calculationStep();
   //function that updates the circular buffer after receiving a new geometry message
   void reviseCircBuff(ros::Time now, geometry_msgs::Twist cmd_vel);
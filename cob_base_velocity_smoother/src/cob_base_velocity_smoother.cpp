@@ -27,6 +27,249 @@
  * cob_base_velocity_smoother subsribes (input) and publishes (output) geometry_msgs::Twist.
  ****************************************************************/
 
+// deviations closer than this are equal, so rounding of the running sum does not decide which message is dropped
+const double DEVIATION_TOLERANCE = 1e-9;
+
+WindowAxisStatistics::WindowAxisStatistics()
+{
+  clear();
+}
+
+void WindowAxisStatistics::setCapacity(unsigned int capacity)
+{
+  max_.set_capacity(capacity);
+  min_.set_capacity(capacity);
+  clear();
+}
+
+void WindowAxisStatistics::clear()
+{
+  sum_ = 0.0;
+  nonzero_ = 0;
+  head_ = 0;
+  tail_ = 0;
+  max_.clear();
+  min_.clear();
+}
+
+void WindowAxisStatistics::push(double value)
+{
+  sum_ += value;
+  if(value != 0.0)
+  {
+    nonzero_++;
+  }
+
+  // older candidates that are not larger (smaller) than the new value can never be the extreme again
+  Candidate candidate = {value, head_++};
+  while(!max_.empty() && max_.back().value <= value)
+  {
+    max_.pop_back();
+  }
+  max_.push_back(candidate);
+  while(!min_.empty() && min_.back().value >= value)
+  {
+    min_.pop_back();
+  }
+  min_.push_back(candidate);
+}
+
+void WindowAxisStatistics::pop(double value)
+{
+  if(head_ == tail_)
+  {
+    return;
+  }
+
+  if(value != 0.0)
+  {
+    nonzero_--;
+  }
+  // restart from an exact zero instead of accumulating rounding errors
+  sum_ = (nonzero_ == 0) ? 0.0 : sum_ - value;
+
+  if(!max_.empty() && max_.front().sequence == tail_)
+  {
+    max_.pop_front();
+  }
+  if(!min_.empty() && min_.front().sequence == tail_)
+  {
+    min_.pop_front();
+  }
+  tail_++;
+}
+
+bool WindowAxisStatistics::isZero() const
+{
+  return nonzero_ == 0;
+}
+
+double WindowAxisStatistics::getMean(unsigned int zeros) const
+{
+  const unsigned long size = head_ - tail_ + zeros;
+  if(size == 0)
+  {
+    return 0.0;
+  }
+
+  double result = sum_ / size;
+  if(size > 1)
+  {
+    // the value deviating most from the mean is either the max or the min, on equal deviation the newer one
+    // the zeros are older than all stored values
+    Candidate zero = {0.0, tail_ - 1};
+    Candidate max = (!max_.empty() && (zeros == 0 || max_.front().value >= 0.0)) ? max_.front() : zero;
+    Candidate min = (!min_.empty() && (zeros == 0 || min_.front().value <= 0.0)) ? min_.front() : zero;
+    double max_deviation = fabs(result - max.value);
+    double min_deviation = fabs(result - min.value);
+    double outlier = max.value;
+    if(min_deviation > max_deviation + DEVIATION_TOLERANCE
+       || (min_deviation >= max_deviation - DEVIATION_TOLERANCE && min.sequence > max.sequence))
+    {
+      outlier = min.value;
+    }
+    result = (sum_ - outlier) / (size - 1);
+  }
+
+  return result;
+}
+
+VelocityRingBuffer::VelocityRingBuffer()
+{
+  setCapacity(0);
+}
+
+void VelocityRingBuffer::setCapacity(unsigned int capacity)
+{
+  capacity_ = capacity;
+  vx_.assign(capacity, 0.0);
+  vy_.assign(capacity, 0.0);
+  vtheta_.assign(capacity, 0.0);
+  stamp_.assign(capacity, ros::Time());
+  stats_x_.setCapacity(capacity);
+  stats_y_.setCapacity(capacity);
+  stats_z_.setCapacity(capacity);
+  head_ = 0;
+  count_ = 0;
+  zeros_ = 0;
+}
+
+unsigned int VelocityRingBuffer::size() const
+{
+  return count_ + zeros_;
+}
+
+bool VelocityRingBuffer::empty() const
+{
+  return size() == 0;
+}
+
+bool VelocityRingBuffer::full() const
+{
+  return size() >= capacity_;
+}
+
+void VelocityRingBuffer::fillWithZeros(ros::Time stamp)
+{
+  head_ = 0;
+  count_ = 0;
+  stats_x_.clear();
+  stats_y_.clear();
+  stats_z_.clear();
+
+  zeros_ = capacity_;
+  zero_stamp_ = stamp;
+}
+
+void VelocityRingBuffer::push(ros::Time stamp, double vx, double vy, double vtheta)
+{
+  if(capacity_ == 0)
+  {
+    return;
+  }
+  if(full())
+  {
+    popOldest();
+  }
+
+  vx_[head_] = vx;
+  vy_[head_] = vy;
+  vtheta_[head_] = vtheta;
+  stamp_[head_] = stamp;
+  head_ = (head_ + 1) % capacity_;
+  count_++;
+
+  stats_x_.push(vx);
+  stats_y_.push(vy);
+  stats_z_.push(vtheta);
+}
+
+void VelocityRingBuffer::expire(ros::Time watermark)
+{
+  // the timestamps increase from the zeros over the oldest to the newest message
+  if(zeros_ > 0)
+  {
+    if(zero_stamp_ > watermark)
+    {
+      return;
+    }
+    zeros_ = 0;
+  }
+
+  while(count_ > 0 && stamp_[(head_ + capacity_ - count_) % capacity_] <= watermark)
+  {
+    popOldest();
+  }
+}
+
+ros::Time VelocityRingBuffer::getStamp(unsigned int age) const
+{
+  if(age >= count_)
+  {
+    return zero_stamp_;
+  }
+  return stamp_[(head_ + capacity_ - 1 - age) % capacity_];
+}
+
+bool VelocityRingBuffer::isZero() const
+{
+  return stats_x_.isZero() && stats_y_.isZero() && stats_z_.isZero();
+}
+
+double VelocityRingBuffer::meanValueX() const
+{
+  return stats_x_.getMean(zeros_);
+}
+
+double VelocityRingBuffer::meanValueY() const
+{
+  return stats_y_.getMean(zeros_);
+}
+
+double VelocityRingBuffer::meanValueZ() const
+{
+  return stats_z_.getMean(zeros_);
+}
+
+void VelocityRingBuffer::popOldest()
+{
+  if(zeros_ > 0)
+  {
+    zeros_--;
+    return;
+  }
+  if(count_ == 0)
+  {
+    return;
+  }
+
+  const unsigned int tail = (head_ + capacity_ - count_) % capacity_;
+  stats_x_.pop(vx_[tail]);
+  stats_y_.pop(vy_[tail]);
+  stats_z_.pop(vtheta_[tail]);
+  count_--;
+}
+
 // function for checking wether a new msg has been received, triggering publishers accordingly
 void cob_base_velocity_smoother::set_new_msg_received(bool received)
 {
@@ -104,6 +347,12 @@ cob_base_velocity_smoother::cob_base_velocity_smoother()
   }
   max_delay_between_commands_ = 1/min_input_rate;
 
+  if( !pnh_.hasParam("timing_report_period") )
+  {
+    ROS_WARN("No parameter timing_report_period on parameter server. Using default [10 in s]");
+  }
+  pnh_.param("timing_report_period", timing_report_period_, 10.0);
+
   // set a geometry message containing zero-values
   zero_values_.linear.x = 0.0;
   zero_values_.linear.y = 0.0;
@@ -113,20 +362,28 @@ cob_base_velocity_smoother::cob_base_velocity_smoother()
   zero_values_.angular.y = 0.0;
   zero_values_.angular.z = 0.0;
 
-  // initialize circular buffers
-  cb_.set_capacity(buffer_capacity_);
-  cb_out_.set_capacity(buffer_capacity_);
-  cb_time_.set_capacity(buffer_capacity_);
+  // initialize ring buffer
+  buffer_.setCapacity(std::max(buffer_capacity_, 1));
+  has_output_ = false;
 
   // set actual ros::Time
   ros::Time now = ros::Time::now();
 
-  // fill circular buffer with zero values
-  while(cb_.full() == false)
-  {
-    cb_.push_front(zero_values_);
-    cb_time_.push_front(now);
-  }
+  // fill ring buffer with zero values
+  buffer_.fillWithZeros(now);
+
+  // nothing to do until the first message arrives
+  last_step_ = now;
+  last_msg_time_ = now;
+  idle_ = true;
+  published_ = false;
+  timing_ = StepTiming();
+  timing_.interval_min = std::numeric_limits<double>::max();
+  last_publish_wall_ = ros::WallTime::now();
+  last_report_wall_ = last_publish_wall_;
+
+  step_timer_ = nh_.createTimer(ros::Duration(1.0 / loop_rate_), &cob_base_velocity_smoother::stepTimerCallback,
+                                this, true, false);
 };
 
 // destructor
@@ -137,39 +394,155 @@ void cob_base_velocity_smoother::geometryCallback(const geometry_msgs::Twist::Co
 {
   sub_msg_ = *cmd_vel;
   set_new_msg_received(true);
+
+  // at most one step per loop period, a message arriving earlier is processed at the end of the period
+  // (a newer message arriving meanwhile replaces it)
+  ros::Time now = ros::Time::now();
+  if ((now - last_step_).toSec() >= 1.0 / loop_rate_)
+  {
+    calculationStep();
+  }
+  else
+  {
+    scheduleNextStep(now);
+  }
 }
 
-// calculation function called periodically in main
+void cob_base_velocity_smoother::stepTimerCallback(const ros::TimerEvent& event)
+{
+  double wakeup = std::max(0.0, (event.current_real - event.current_expected).toSec());
+  timing_.wakeups++;
+  timing_.wakeup_sum += wakeup;
+  timing_.wakeup_max = std::max(timing_.wakeup_max, wakeup);
+
+  calculationStep();
+}
+
+// calculation function called for new messages and by the step timer
 void cob_base_velocity_smoother::calculationStep()
 {
   // set current ros::Time
   ros::Time now = ros::Time::now();
-  static ros::Time last = now;
+  ros::WallTime compute_start = ros::WallTime::now();
+
+  // no steps were run while everything was zero, resume as if zero messages had been stored meanwhile
+  if (idle_)
+  {
+    buffer_.fillWithZeros(now - ros::Duration(1.0 / loop_rate_));
+    idle_ = false;
+  }
 
   geometry_msgs::Twist result = geometry_msgs::Twist();
+  bool publish = false;
 
   // only publish command if we received a msg or the last message was actually zero
   if (get_new_msg_received())
   {
     // generate Output messages
     result = this->setOutput(now, sub_msg_);
-    pub_.publish(result);
+    publish = true;
 
-    last = now;
+    last_msg_time_ = now;
     set_new_msg_received(false);
   }
   // start writing in zeros if we did not receive a new msg within a certain amount of time.
   // Do not publish! Otherwise, the output of other nodes will be overwritten!
-  else if ( fabs((last - now).toSec()) > max_delay_between_commands_)
+  else if ( fabs((last_msg_time_ - now).toSec()) >= max_delay_between_commands_)
   {
     result = this->setOutput(now, geometry_msgs::Twist());
   }
-  // if last message was a zero msg, fill the buffer with zeros and publish again
+  // if last message was a zero msg, fill the buffer with zeros and publish again as long as the output changes
   else if (IsZeroMsg(sub_msg_))
   {
     result = this->setOutput(now, sub_msg_);
+    publish = !published_ || !IsEqual(result, last_published_);
+  }
+
+  ros::WallTime compute_end = ros::WallTime::now();
+  double compute = (compute_end - compute_start).toSec();
+  timing_.steps++;
+  timing_.compute_sum += compute;
+  timing_.compute_max = std::max(timing_.compute_max, compute);
+
+  if (publish)
+  {
     pub_.publish(result);
+    last_published_ = result;
+
+    if (published_)
+    {
+      double interval = (compute_end - last_publish_wall_).toSec();
+      timing_.interval_min = std::min(timing_.interval_min, interval);
+      timing_.interval_max = std::max(timing_.interval_max, interval);
+    }
+    timing_.publishes++;
+    last_publish_wall_ = compute_end;
+    published_ = true;
   }
+
+  last_step_ = now;
+  scheduleNextStep(now);
+  reportTiming(compute_end);
+}
+
+// arm the step timer for the next step that is required without a new message
+void cob_base_velocity_smoother::scheduleNextStep(ros::Time now)
+{
+  const ros::Duration period(1.0 / loop_rate_);
+  ros::Time next = last_step_ + period;
+
+  if (!get_new_msg_received())
+  {
+    if (isSettled())
+    {
+      // further steps would only store zeros and republish a zero output
+      idle_ = true;
+      step_timer_.stop();
+      return;
+    }
+
+    // until the timeout, only a zero message has to be repeated every period
+    ros::Time timeout = last_msg_time_ + ros::Duration(max_delay_between_commands_);
+    if (!IsZeroMsg(sub_msg_) && next < timeout)
+    {
+      next = timeout;
+    }
+  }
+
+  step_timer_.stop();
+  step_timer_.setPeriod(ros::Duration(std::max((next - now).toSec(), 0.001)));
+  step_timer_.start();
+}
+
+// true if all stored messages and the last output are zero, so further steps would not change anything
+bool cob_base_velocity_smoother::isSettled()
+{
+  return buffer_.isZero() && (!has_output_ || IsZeroMsg(last_output_));
+}
+
+void cob_base_velocity_smoother::reportTiming(ros::WallTime now)
+{
+  if (timing_report_period_ <= 0.0 || (now - last_report_wall_).toSec() < timing_report_period_)
+  {
+    return;
+  }
+
+  if (timing_.steps > 0)
+  {
+    // intervals are only known from the second published message on
+    bool intervals = timing_.interval_min <= timing_.interval_max;
+    ROS_DEBUG_NAMED("timing", "cob_base_velocity_smoother: %u steps, compute mean %.1f us, max %.1f us; "
+                    "%u timer steps, wakeup delay mean %.1f us, max %.1f us; "
+                    "%u publishes, interval min %.1f ms, max %.1f ms",
+                    timing_.steps, 1e6 * timing_.compute_sum / timing_.steps, 1e6 * timing_.compute_max,
+                    timing_.wakeups, timing_.wakeups ? 1e6 * timing_.wakeup_sum / timing_.wakeups : 0.0,
+                    1e6 * timing_.wakeup_max, timing_.publishes,
+                    intervals ? 1e3 * timing_.interval_min : 0.0, intervals ? 1e3 * timing_.interval_max : 0.0);
+  }
+
+  timing_ = StepTiming();
+  timing_.interval_min = std::numeric_limits<double>::max();
+  last_report_wall_ = now;
 }
 
 // function for the actual computation
@@ -190,8 +563,9 @@ geometry_msgs::Twist cob_base_velocity_smoother::setOutput(ros::Time now, geomet
   // limit acceleration
   this->limitAcceleration(now, result);
 
-  // insert the result-message into the circular-buffer storing the output
-  cb_out_.push_front(result);
+  // store the result-message as last output
+  last_output_ = result;
+  has_output_ = true;
 
   return result;
 }
@@ -203,64 +577,38 @@ void cob_base_velocity_smoother::reviseCircBuff(ros::Time now, geometry_msgs::Tw
   {
     // the circular buffer is out of date, so clear and refill with zero messages before adding the new command
 
-    // clear buffers
-    cb_.clear();
-    cb_time_.clear();
+    // fill ring buffer with zero_values_ and actual time-stamp
+    buffer_.fillWithZeros(now);
 
-    // fill circular buffer with zero_values_ and time buffer with actual time-stamp
-    while(cb_.full() == false)
-    {
-      cb_.push_front(zero_values_);
-      cb_time_.push_front(now);
-    }
-
-    // add new command velocity message to circular buffer
-    cb_.push_front(cmd_vel);
-    // add new timestamp for subscribed command velocity message
-    cb_time_.push_front(now);
+    // add new command velocity message to ring buffer
+    buffer_.push(now, cmd_vel.linear.x, cmd_vel.linear.y, cmd_vel.angular.z);
   }
   else
   {
     // only some elements of the circular buffer are out of date, so only delete those
-    double delay=(now.toSec() - cb_time_.back().toSec());
+    buffer_.expire(now - ros::Duration(store_delay_));
 
-    while( delay >= store_delay_ )
-    {
-      // remove out-dated messages
-      cb_.pop_back();
-      cb_time_.pop_back();
-
-      delay=(now.toSec() - cb_time_.back().toSec());
-    }
     // if the circular buffer is empty now, refill with zero values
-    if(cb_.empty() == true)
+    if(buffer_.empty() == true)
     {
-      while(cb_.full() == false)
-      {
-        cb_.push_front(zero_values_);
-        cb_time_.push_front(now);
-      }
+      buffer_.fillWithZeros(now);
     }
     if(this->IsZeroMsg(cmd_vel))
     {
       // here we subscribed  a zero message, so we want to stop the robot
-      long unsigned int size = floor( cb_.size() / 3 );
+      long unsigned int size = floor( buffer_.size() / 3 );
 
-      // to stop the robot faster, fill the circular buffer with more than one, in fact floor (cb_.size() / 3 ), zero messages
+      // to stop the robot faster, fill the circular buffer with more than one, in fact floor (size / 3 ), zero messages
       for(long unsigned int i=0; i< size; i++)
       {
-        // add new command velocity message to circular buffer
-        cb_.push_front(cmd_vel);
-        // add new timestamp for subscribed command velocity message
-        cb_time_.push_front(now);
+        // add new command velocity message to ring buffer
+        buffer_.push(now, cmd_vel.linear.x, cmd_vel.linear.y, cmd_vel.angular.z);
       }
     }
     else
     {
-      // add new command velocity message to circular buffer
-      cb_.push_front(cmd_vel);
-      // add new timestamp for subscribed command velocity message
-      cb_time_.push_front(now);
+      // add new command velocity message to ring buffer
+      buffer_.push(now, cmd_vel.linear.x, cmd_vel.linear.y, cmd_vel.angular.z);
     }
   }
 };
@@ -268,21 +616,8 @@ void cob_base_velocity_smoother::reviseCircBuff(ros::Time now, geometry_msgs::Tw
 // returns true if all messages in cb are out of date in consideration of store_delay
 bool cob_base_velocity_smoother::circBuffOutOfDate(ros::Time now)
 {
-  bool result=true;
-
-  long unsigned int count=0;
-
-  while( (count < cb_.size()) && (result == true) )
-  {
-    double delay=(now.toSec() - cb_time_[count].toSec());
-    if(delay < store_delay_)
-    {
-      result = false;
-    }
-    count++;
-  }
-
-  return result;
+  // the newest message has the latest timestamp
+  return buffer_.empty() || (now.toSec() - buffer_.getStamp(0).toSec()) >= store_delay_;
 };
 
 // returns true if the input msg cmd_vel equals zero_values_, false otherwise
@@ -312,124 +647,19 @@ int cob_base_velocity_smoother::signum(double var)
 // functions to calculate the mean values for linear/x
 double cob_base_velocity_smoother::meanValueX()
 {
-  double result = 0;
-  long unsigned int size = cb_.size();
-
-  // calculate sum
-  for(long unsigned int i=0; i<size; i++)
-  {
-    result += cb_[i].linear.x;
-  }
-  result /= size;
-
-  if(size > 1)
-  {
-    double help_result = 0;
-    double max = cb_[0].linear.x;
-    long unsigned int max_ind = 0;
-    for(long unsigned int i=0; i<size; i++)
-    {
-      if(abs(result-cb_[i].linear.x) > abs(result-max))
-      {
-        max = cb_[i].linear.x;
-        max_ind = i;
-      }
-    }
-
-    // calculate sum
-    for(long unsigned int i=0; i<size; i++)
-    {
-      if(i != max_ind)
-      {
-        help_result += cb_[i].linear.x;
-      }
-    }
-    result = help_result / (size - 1);
-  }
-
-  return result;
+  return buffer_.meanValueX();
 };
 
 // functions to calculate the mean values for linear/y
 double cob_base_velocity_smoother::meanValueY()
 {
-  double result = 0;
-  long unsigned int size = cb_.size();
-
-  // calculate sum
-  for(long unsigned int i=0; i<size; i++)
-  {
-    result += cb_[i].linear.y;
-  }
-  result /= size;
-
-  if(size > 1)
-  {
-    double help_result = 0;
-    double max = cb_[0].linear.y;
-    long unsigned int max_ind = 0;
-    for(long unsigned int i=0; i<size; i++)
-    {
-      if(abs(result-cb_[i].linear.y) > abs(result-max))
-      {
-        max = cb_[i].linear.y;
-        max_ind = i;
-      }
-    }
-
-    // calculate sum
-    for(long unsigned int i=0; i<size; i++)
-    {
-      if(i != max_ind)
-      {
-        help_result += cb_[i].linear.y;
-      }
-    }
-    result = help_result / (size - 1);
-  }
-
-  return result;
+  return buffer_.meanValueY();
 };
 
 // functions to calculate the mean values for angular/z
 double cob_base_velocity_smoother::meanValueZ()
 {
-  double result = 0;
-  long unsigned int size = cb_.size();
-
-  // calculate sum
-  for(long unsigned int i=0; i<size; i++)
-  {
-    result += cb_[i].angular.z;
-  }
-  result /= size;
-
-  if(size > 1)
-  {
-    double help_result = 0;
-    double max = cb_[0].angular.z;
-    long unsigned int max_ind = 0;
-    for(long unsigned int i = 0; i < size; i++)
-    {
-      if(abs(result-cb_[i].angular.z) > abs(result-max))
-      {
-        max = cb_[i].angular.z;
-        max_ind = i;
-      }
-    }
-
-    // calculate sum
-    for(long unsigned int i = 0; i < size; i++)
-    {
-      if(i != max_ind)
-      {
-        help_result += cb_[i].angular.z;
-      }
-    }
-    result = help_result / (size - 1);
-  }
-
-  return result;
+  return buffer_.meanValueZ();
 };
 
 // function to make the loop rate availabe outside the class
@@ -459,33 +689,33 @@ void cob_base_velocity_smoother::limitAcceleration(ros::Time now, geometry_msgs:
 
   double deltaTime = 0;
 
-  if(cb_time_.size() > 1)
+  if(buffer_.size() > 2)
   {
-    deltaTime = now.toSec() - cb_time_[2].toSec();
+    deltaTime = now.toSec() - buffer_.getStamp(2).toSec();
   }
 
-  if( cb_out_.size() > 0)
+  if(has_output_)
   {
     if(deltaTime > 0)
     {
       // set delta velocity and acceleration values
-      double deltaX = result.linear.x - cb_out_.front().linear.x;
+      double deltaX = result.linear.x - last_output_.linear.x;
 
-      double deltaY = result.linear.y - cb_out_.front().linear.y;
+      double deltaY = result.linear.y - last_output_.linear.y;
 
-      double deltaZ = result.angular.z - cb_out_.front().angular.z;
+      double deltaZ = result.angular.z - last_output_.angular.z;
 
-      if( abs(deltaX) > acc_limit_)
+      if( fabs(deltaX) > acc_limit_)
       {
-        result.linear.x = cb_out_.front().linear.x + this->signum(deltaX) * acc_limit_;
+        result.linear.x = last_output_.linear.x + this->signum(deltaX) * acc_limit_;
       }
-      if( abs(deltaY) > acc_limit_ )
+      if( fabs(deltaY) > acc_limit_ )
       {
-        result.linear.y = cb_out_.front().linear.y + this->signum(deltaY) * acc_limit_;
+        result.linear.y = last_output_.linear.y + this->signum(deltaY) * acc_limit_;
       }
-      if( abs(deltaZ) > acc_limit_ )
+      if( fabs(deltaZ) > acc_limit_ )
       {
-        result.angular.z = cb_out_.front().angular.z + this->signum(deltaZ) * acc_limit_;
+        result.angular.z = last_output_.angular.z + this->signum(deltaZ) * acc_limit_;
       }
     }
   }
@@ -499,16 +729,8 @@ int main(int argc, char **argv)
 
   // create Node Class
   cob_base_velocity_smoother my_velocity_smoother;
-  // get loop rate from class member
-  ros::Rate rate(my_velocity_smoother.getLoopRate());
-  // actual calculation step with given frequency
-  while(my_velocity_smoother.nh_.ok())
-  {
-    my_velocity_smoother.calculationStep();
-
-    ros::spinOnce();
-    rate.sleep();
-  }
+  // calculation steps are triggered by new messages and by the step timer, at most with the loop rate
+  ros::spin();
 
   return 0;
 }
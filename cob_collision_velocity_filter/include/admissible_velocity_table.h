@@ -0,0 +1,110 @@
+/*
+ * Copyright 2017 Fraunhofer Institute for Manufacturing Engineering and Automation (IPA)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+#ifndef COB_ADMISSIBLE_VELOCITY_TABLE_H
+#define COB_ADMISSIBLE_VELOCITY_TABLE_H
+
+// standard includes
+#include <vector>
+
+// ROS message includes
+#include <geometry_msgs/Point.h>
+
+#include "footprint_distance.h"
+
+namespace cob_collision_velocity_filter
+{
+
+///
+/// @class AdmissibleVelocityTable
+/// @brief dynamic window like table of the max admissible speed per direction in velocity space
+///
+/// Directions of the velocity normalized by (v_max, v_max, vtheta_max) are discretized by azimuth (direction of the
+/// linear velocity) and elevation (share of the rotation). For each direction the footprint is swept along its
+/// constant curvature path over the reaction time and the braking distance. The admissible speed is the largest one
+/// whose path does not bring the footprint closer than stop_threshold to an obstacle (or, if the robot already is
+/// that close, not closer than it already is).
+/// Commands are then limited to the smallest admissible speed of the neighbouring table directions.
+///
+class AdmissibleVelocityTable
+{
+public:
+    ///
+    /// @brief  Constructor
+    /// @param  nr_azimuth - number of directions of the linear velocity
+    /// @param  nr_elevation - number of rotational shares from pure rotation (-) to pure rotation (+)
+    ///
+    AdmissibleVelocityTable(unsigned int nr_azimuth = 16, unsigned int nr_elevation = 9);
+
+    ///
+    /// @brief  Destructor
+    ///
+    ~AdmissibleVelocityTable();
+
+    ///
+    /// @brief  sets velocity and acceleration limits, reaction time and stop threshold
+    /// @return true if any value changed
+    ///
+    bool setLimits(double v_max, double vtheta_max, double ax_max, double ay_max, double atheta_max,
+                   double reaction_time, double stop_threshold);
+
+    ///
+    /// @brief  sets the footprint polygon used for the sweep
+    /// @return true if the footprint changed
+    ///
+    bool setFootprint(const std::vector<geometry_msgs::Point>& footprint);
+
+    ///
+    /// @brief  recomputes the table for the given obstacles
+    /// @param  obstacles - obstacle points in robot_frame
+    ///
+    void update(const std::vector<geometry_msgs::Point>& obstacles);
+
+    ///
+    /// @brief  returns the factor in [0, 1] the command has to be scaled with to be admissible
+    /// @param  vx, vy, vtheta - commanded velocity
+    ///
+    double getScale(double vx, double vy, double vtheta) const;
+
+protected:
+    ///
+    /// @brief  computes the max admissible speed (relative to the limits) in one normalized direction
+    ///
+    double computeAdmissibleSpeed(double nx, double ny, double ntheta,
+                                  const std::vector<geometry_msgs::Point>& obstacles,
+                                  double collision_distance) const;
+
+    ///
+    /// @brief  returns the table entry for the given azimuth and elevation index
+    ///
+    double getEntry(unsigned int azimuth, unsigned int elevation) const;
+
+    unsigned int nr_azimuth_, nr_elevation_;
+    std::vector<double> admissible_speed_;  ///< indexed by elevation * nr_azimuth_ + azimuth
+
+    double v_max_, vtheta_max_;
+    double ax_max_, ay_max_, atheta_max_;
+    double reaction_time_, stop_threshold_;
+
+    FootprintDistance footprint_distance_;
+    double circumscribed_radius_;
+};
+
+}
+
+#endif // COB_ADMISSIBLE_VELOCITY_TABLE_H
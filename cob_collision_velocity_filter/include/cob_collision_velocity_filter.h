@@ -28,17 +28,17 @@
 #include <ros/ros.h>
 #include <XmlRpc.h>
 
-#include <pthread.h>
-
 // ROS message includes
 #include <geometry_msgs/Twist.h>
 #include <geometry_msgs/PolygonStamped.h>
 #include <geometry_msgs/Polygon.h>
 #include <nav_msgs/OccupancyGrid.h>
+#include <nav_msgs/GridCells.h>
 
 #include <boost/tokenizer.hpp>
 #include <boost/foreach.hpp>
 #include <boost/algorithm/string.hpp>
+#include <boost/shared_ptr.hpp>
 
 // ROS service includes
 #include "cob_footprint_observer/GetFootprint.h"
@@ -50,6 +50,9 @@
 // BUT velocity limited marker
 #include "velocity_limited_marker.h"
 
+// filter independent of the ROS node
+#include "collision_filter_core.h"
+
 // Costmap for obstacle detection
 #include <costmap_2d/costmap_2d_ros.h>
 
@@ -90,6 +93,18 @@ public:
   ///
   void getFootprint(const ros::TimerEvent&);
 
+  ///
+  /// @brief  publishes a footprint as new snapshot for the command path
+  /// @param  footprint - footprint polygon in robot_frame
+  ///
+  void publishFootprint(const std::vector<geometry_msgs::Point>& footprint);
+
+  ///
+  /// @brief  Timer callback, publishes the relevant obstacles of the last command as grid and as sparse cell list
+  ///         if there are subscribers
+  ///
+  void publishRelevantObstacles(const ros::TimerEvent&);
+
   ///
   /// @brief  Dynamic reconfigure callback
   /// @param  config - configuration file with dynamic reconfigureable parameters
@@ -108,9 +123,13 @@ public:
   /// Timer for periodically calling GetFootprint Service
   ros::Timer get_footprint_timer_;
 
+  /// Timer for publishing the relevant obstacles
+  ros::Timer publish_relevant_obstacles_timer_;
+
   /// declaration of publisher
   ros::Publisher topic_pub_command_;
   ros::Publisher topic_pub_relevant_obstacles_;
+  ros::Publisher topic_pub_relevant_obstacle_cells_;
 
   /// declaration of subscriber
   ros::Subscriber joystick_velocity_sub_, obstacles_sub_;
@@ -132,64 +151,56 @@ private:
 
   ///
   /// @brief  checks for obstacles in driving direction of the robot (rotation included)
-  ///         and publishes relevant obstacles
+  ///         and hands the relevant obstacles over for publishing
   ///
   void obstacleHandler();
 
-  /* helper functions */
-
-  ///
-  /// @brief  returns the sign of x
-  ///
-  double sign(double x);
-
   ///
-  /// @brief  computes distance between two points
-  /// @param  a,b - Points
-  /// @return distance
+  /// @brief  takes over the latest footprint and parameter snapshots into the filter core
   ///
-  double getDistance2d(geometry_msgs::Point a, geometry_msgs::Point b);
-
-  ///
-  /// @brief  checks if obstacle lies already within footprint -> this is ignored due to sensor readings of the hull etc
-  /// @param  x_obstacle - x coordinate of obstacle in occupancy grid local costmap
-  /// @param  y_obstacle - y coordinate of obstacle in occupancy grid local costmap
-  /// @return true if obstacle outside of footprint
-  ///
-  bool obstacleValid(double x_obstacle, double y_obstacle);
+  void applySnapshots();
 
   ///
   /// @brief  stops movement of the robot
   ///
   void stopMovement();
 
-  pthread_mutex_t m_mutex;
-
-  //obstacle_treshold
-  int costmap_obstacle_treshold_;
+  /// immutable snapshots, written by the timer / dynamic reconfigure callbacks and swapped atomically
+  struct FootprintSnapshot
+  {
+    std::vector<geometry_msgs::Point> points;
+  };
+  struct FilterParameters
+  {
+    double influence_radius, stop_threshold, obstacle_damping_dist;
+  };
+  boost::shared_ptr<const FootprintSnapshot> footprint_snapshot_, applied_footprint_snapshot_;
+  boost::shared_ptr<const FilterParameters> parameters_snapshot_, applied_parameters_snapshot_;
 
   //frames
   std::string global_frame_, robot_frame_;
 
   //velocity
   geometry_msgs::Vector3 robot_twist_linear_, robot_twist_angular_;
-  double v_max_, vtheta_max_;
-  double ax_max_, ay_max_, atheta_max_;
 
-  //obstacle avoidance
-  std::vector<geometry_msgs::Point> robot_footprint_;
-  double footprint_left_, footprint_right_, footprint_front_, footprint_rear_;
-  double footprint_left_initial_, footprint_right_initial_, footprint_front_initial_, footprint_rear_initial_;
+  //obstacle avoidance, command path only
+  cob_collision_velocity_filter::CollisionFilterCore core_;
   bool costmap_received_;
   nav_msgs::OccupancyGrid last_costmap_received_, relevant_obstacles_;
-  double influence_radius_, stop_threshold_, obstacle_damping_dist_, use_circumscribed_threshold_;
-  double closest_obstacle_dist_, closest_obstacle_angle_;
+  nav_msgs::GridCells relevant_obstacle_cells_;
+
+  //indices of the relevant costmap cells of the last command and the costmap geometry they refer to
+  struct RelevantCells
+  {
+    std::vector<unsigned int> indices;
+    unsigned int size_x, size_y;
+    double resolution, origin_x, origin_y;
+  };
+  boost::shared_ptr<const RelevantCells> relevant_cells_snapshot_;
+  unsigned int relevant_cells_version_;  //evaluation version of the core the snapshot was taken from
 
   // variables for slow down behavior
   double last_time_;
-  double kp_, kv_;
-  double vx_last_, vy_last_, vtheta_last_;
-  double virt_mass_;
 
   // BUT velocity limited marker
   cob_collision_velocity_filter::VelocityLimitedMarker velocity_limited_marker_;
@@ -0,0 +1,227 @@
+/*
+ * Copyright 2017 Fraunhofer Institute for Manufacturing Engineering and Automation (IPA)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+#ifndef COB_COLLISION_FILTER_CORE_H
+#define COB_COLLISION_FILTER_CORE_H
+
+// standard includes
+#include <vector>
+
+// ROS message includes
+#include <geometry_msgs/Point.h>
+#include <geometry_msgs/Twist.h>
+
+#include "footprint_distance.h"
+#include "admissible_velocity_table.h"
+
+namespace cob_collision_velocity_filter
+{
+
+///
+/// @brief raw view on the anti collision costmap, the robot is at the origin of its frame
+///
+struct CostmapView
+{
+  const unsigned char* data;  ///< size_x * size_y cells, row major
+  unsigned int size_x, size_y;
+  double resolution;
+  double origin_x, origin_y;
+};
+
+///
+/// @brief parameters of the collision velocity filter
+///
+struct CollisionFilterParameters
+{
+  CollisionFilterParameters()
+  : costmap_obstacle_treshold(250),
+    influence_radius(1.5),
+    stop_threshold(0.10),
+    obstacle_damping_dist(5.0),
+    use_circumscribed_threshold(0.20),
+    v_max(0.6),
+    vtheta_max(0.8),
+    ax_max(0.5),
+    ay_max(0.5),
+    atheta_max(0.7),
+    kp(2.0),
+    kv(1.0),
+    virt_mass(0.8),
+    use_polygon_footprint(false),
+    use_dynamic_window(false),
+    dynamic_window_reaction_time(0.2)
+  {}
+
+  int costmap_obstacle_treshold;
+  double influence_radius, stop_threshold, obstacle_damping_dist, use_circumscribed_threshold;
+  double v_max, vtheta_max;
+  double ax_max, ay_max, atheta_max;
+  double kp, kv, virt_mass;
+  bool use_polygon_footprint;
+  bool use_dynamic_window;
+  double dynamic_window_reaction_time;
+};
+
+///
+/// @class CollisionFilterCore
+/// @brief checks for obstacles in driving direction and limits the commanded velocity,
+///        independent of the ROS node (no costmap_2d, publishers or clock)
+///
+class CollisionFilterCore
+{
+public:
+  ///
+  /// @brief  Constructor
+  ///
+  CollisionFilterCore();
+
+  ///
+  /// @brief  Destructor
+  ///
+  ~CollisionFilterCore();
+
+  ///
+  /// @brief  sets the filter parameters
+  ///
+  void setParameters(const CollisionFilterParameters& parameters);
+
+  ///
+  /// @brief  returns the filter parameters
+  ///
+  const CollisionFilterParameters& getParameters() const;
+
+  ///
+  /// @brief  sets the footprint and reduces it to its extents
+  /// @param  footprint - footprint polygon in robot_frame
+  ///
+  void setFootprint(const std::vector<geometry_msgs::Point>& footprint);
+
+  ///
+  /// @brief  checks for obstacles in driving direction of the robot (rotation included)
+  /// @param  costmap - the anti collision costmap
+  /// @param  twist - commanded velocity
+  /// @return false if neither the obstacles nor the command changed and the last result was kept
+  ///
+  bool evaluateObstacles(const CostmapView& costmap, const geometry_msgs::Twist& twist);
+
+  ///
+  /// @brief  computes the command velocity from the last obstacle evaluation (slows down / limits acceleration)
+  /// @param  twist - commanded velocity
+  /// @param  dt - time since the last command
+  /// @param  cmd_vel - the corrected velocity
+  /// @return false if the robot has to stop because an obstacle is within stop_threshold
+  ///
+  bool computeCommand(const geometry_msgs::Twist& twist, double dt, geometry_msgs::Twist& cmd_vel);
+
+  ///
+  /// @brief  resets the last commanded velocity after the robot was stopped
+  ///
+  void stop();
+
+  double getClosestObstacleDistance() const;
+  double getClosestObstacleAngle() const;
+
+  ///
+  /// @brief  returns the indices of the relevant cells of the last obstacle evaluation
+  ///
+  const std::vector<unsigned int>& getRelevantCells() const;
+
+  ///
+  /// @brief  returns a counter that is incremented whenever evaluateObstacles re-evaluated the obstacles
+  ///
+  unsigned int getEvaluationVersion() const;
+
+protected:
+  ///
+  /// @brief  rebuilds the per-cell range, angle and footprint-border distance tables
+  ///         if the costmap geometry or the footprint changed since the last call
+  /// @param  size_x, size_y - size of the costmap in cells
+  /// @param  resolution - resolution of the costmap
+  /// @param  origin_x, origin_y - origin of the costmap in robot_frame
+  /// @return true if the tables were rebuilt
+  ///
+  bool updateLookupTables(unsigned int size_x, unsigned int size_y, double resolution, double origin_x,
+                          double origin_y);
+
+  ///
+  /// @brief  collects the occupied cells within radius that lie outside of the footprint,
+  ///         if the costmap, the lookup tables or the radius changed since the last call
+  /// @param  costmap - the anti collision costmap
+  /// @param  radius - max distance of relevant cells from the robot center
+  /// @param  tables_changed - whether the lookup tables were rebuilt for this call
+  /// @return true if the occupied cells were collected again
+  ///
+  bool updateOccupiedCells(const CostmapView& costmap, double radius, bool tables_changed);
+
+  ///
+  /// @brief  returns the sign of x
+  ///
+  double sign(double x);
+
+  ///
+  /// @brief  checks if obstacle lies already within footprint -> this is ignored due to sensor readings of the hull etc
+  /// @param  x_obstacle - x coordinate of obstacle in occupancy grid local costmap
+  /// @param  y_obstacle - y coordinate of obstacle in occupancy grid local costmap
+  /// @return true if obstacle outside of footprint
+  ///
+  bool obstacleValid(double x_obstacle, double y_obstacle);
+
+  CollisionFilterParameters parameters_;
+
+  //obstacle avoidance
+  std::vector<geometry_msgs::Point> robot_footprint_;
+  double footprint_left_, footprint_right_, footprint_front_, footprint_rear_;
+  FootprintDistance footprint_distance_;
+  double closest_obstacle_dist_, closest_obstacle_angle_;
+  std::vector<unsigned int> relevant_cells_;
+
+  //polar lookup tables per costmap cell, valid for the geometry and footprint stored below
+  std::vector<double> cell_range_, cell_angle_, cell_border_dist_;
+  bool lookup_tables_valid_;
+  unsigned int table_size_x_, table_size_y_;
+  double table_resolution_, table_origin_x_, table_origin_y_;
+  double table_footprint_front_, table_footprint_rear_, table_footprint_left_, table_footprint_right_;
+
+  //occupied cells of the last costmap version within occupied_cells_radius_, in robot_frame
+  struct OccupiedCell
+  {
+    unsigned int index;
+    double x, y;
+  };
+  std::vector<OccupiedCell> occupied_cells_;
+  std::vector<unsigned char> costmap_snapshot_;  //region of interest of the last costmap version, row major
+  int snapshot_row_min_, snapshot_col_min_;
+  unsigned int snapshot_width_, snapshot_height_, snapshot_size_x_;
+  unsigned int costmap_version_;
+  double occupied_cells_radius_;
+
+  //command and circumscribed radius the relevant obstacles were last evaluated for
+  geometry_msgs::Twist evaluated_twist_;
+  double evaluated_circumscribed_radius_;
+  unsigned int evaluation_version_;
+
+  // variables for slow down behavior
+  double vx_last_, vy_last_, vtheta_last_;
+
+  // velocity space admissibility (dynamic window)
+  AdmissibleVelocityTable admissible_velocities_;
+};
+
+}
+
+#endif // COB_COLLISION_FILTER_CORE_H
@@ -0,0 +1,116 @@
+/*
+ * Copyright 2017 Fraunhofer Institute for Manufacturing Engineering and Automation (IPA)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#pragma once
+#ifndef COB_FOOTPRINT_DISTANCE_H
+#define COB_FOOTPRINT_DISTANCE_H
+
+// standard includes
+#include <vector>
+
+// ROS message includes
+#include <geometry_msgs/Point.h>
+
+namespace cob_collision_velocity_filter
+{
+
+///
+/// @class FootprintDistance
+/// @brief computes the exact distance of points to an arbitrary (convex or concave) polygonal footprint
+///
+/// The edges are stored with their direction, normal and bounding circle. An angular bucket index around the
+/// robot center yields the edges seen in the direction of a point, which give a first upper bound for the distance;
+/// all other edges are only evaluated if their bounding circle can beat that bound, which costs one squared
+/// distance comparison per edge. The sign of the distance is taken from the closest edge (or from the normals of
+/// both adjacent edges if the closest point is a vertex), so the polygon has to be simple.
+///
+class FootprintDistance
+{
+public:
+    ///
+    /// @brief  Constructor
+    /// @param  nr_buckets - number of angular buckets of the edge index
+    ///
+    FootprintDistance(unsigned int nr_buckets = 64);
+
+    ///
+    /// @brief  Destructor
+    ///
+    ~FootprintDistance();
+
+    ///
+    /// @brief  sets the footprint polygon and rebuilds edges and bucket index if it changed
+    /// @param  polygon - vertices of the footprint in robot_frame
+    /// @return true if the polygon changed
+    ///
+    bool setPolygon(const std::vector<geometry_msgs::Point>& polygon);
+
+    ///
+    /// @brief  checks whether a polygon with at least three vertices is set
+    ///
+    bool isValid() const;
+
+    ///
+    /// @brief  checks whether a point lies inside of the footprint (even-odd rule)
+    /// @param  x, y - coordinates of the point in robot_frame
+    ///
+    bool isInside(double x, double y) const;
+
+    ///
+    /// @brief  computes the distance of a point to the border of the footprint
+    /// @param  x, y - coordinates of the point in robot_frame
+    /// @return distance, negative if the point lies inside of the footprint
+    ///
+    double getDistance(double x, double y) const;
+
+protected:
+    struct Edge
+    {
+        double ax, ay;          ///< start vertex
+        double dx, dy;          ///< unit direction
+        double nx, ny;          ///< unit normal pointing outwards
+        double anx, any;        ///< outward normal at the start vertex (sum of the adjacent edge normals)
+        double bnx, bny;        ///< outward normal at the end vertex (sum of the adjacent edge normals)
+        double length;          ///< length of the edge
+        double cx, cy, radius;  ///< bounding circle
+    };
+
+    ///
+    /// @brief  computes the squared distance of a point to an edge
+    /// @param  outside - set to whether the point lies outside of the footprint, valid if the edge is the closest one
+    ///
+    double getSquaredEdgeDistance(const Edge& edge, double x, double y, bool& outside) const;
+
+    ///
+    /// @brief  returns the angular bucket of a point
+    ///
+    unsigned int getBucket(double x, double y) const;
+
+    ///
+    /// @brief  returns the angular bucket of an angle in [-pi, pi]
+    ///
+    unsigned int getBucket(double angle) const;
+
+    unsigned int nr_buckets_;
+    std::vector<geometry_msgs::Point> polygon_;
+    std::vector<Edge> edges_;
+    std::vector<std::vector<unsigned int> > buckets_;
+};
+
+}
+
+#endif // COB_FOOTPRINT_DISTANCE_H
@@ -0,0 +1,215 @@
+/*
+ * Copyright 2017 Fraunhofer Institute for Manufacturing Engineering and Automation (IPA)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <admissible_velocity_table.h>
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace cob_collision_velocity_filter
+{
+
+const double MAX_ADMISSIBLE_SPEED = 2.0;  // relative to the limits, covers commands exceeding them in several axes
+const double PATH_RESOLUTION      = 0.02; // max displacement of the footprint between two sweep steps [m]
+const unsigned int MAX_PATH_STEPS = 500;
+const double MIN_VELOCITY         = 1e-6;
+const double DISTANCE_TOLERANCE   = 1e-3;
+
+
+AdmissibleVelocityTable::AdmissibleVelocityTable(unsigned int nr_azimuth, unsigned int nr_elevation)
+{
+    nr_azimuth_ = std::max(nr_azimuth, 1u);
+    nr_elevation_ = std::max(nr_elevation, 2u);
+    admissible_speed_.assign(nr_azimuth_ * nr_elevation_, MAX_ADMISSIBLE_SPEED);
+
+    v_max_ = 0.0;
+    vtheta_max_ = 0.0;
+    ax_max_ = 0.0;
+    ay_max_ = 0.0;
+    atheta_max_ = 0.0;
+    reaction_time_ = 0.0;
+    stop_threshold_ = 0.0;
+    circumscribed_radius_ = 0.0;
+}
+
+AdmissibleVelocityTable::~AdmissibleVelocityTable()
+{
+}
+
+bool AdmissibleVelocityTable::setLimits(double v_max, double vtheta_max, double ax_max, double ay_max,
+                                        double atheta_max, double reaction_time, double stop_threshold)
+{
+    if (v_max == v_max_ && vtheta_max == vtheta_max_ && ax_max == ax_max_ && ay_max == ay_max_
+        && atheta_max == atheta_max_ && reaction_time == reaction_time_ && stop_threshold == stop_threshold_)
+        return false;
+
+    v_max_ = v_max;
+    vtheta_max_ = vtheta_max;
+    ax_max_ = ax_max;
+    ay_max_ = ay_max;
+    atheta_max_ = atheta_max;
+    reaction_time_ = reaction_time;
+    stop_threshold_ = stop_threshold;
+    return true;
+}
+
+bool AdmissibleVelocityTable::setFootprint(const std::vector<geometry_msgs::Point>& footprint)
+{
+    if (!footprint_distance_.setPolygon(footprint))
+        return false;
+
+    circumscribed_radius_ = 0.0;
+    for (unsigned int i = 0; i < footprint.size(); i++)
+        circumscribed_radius_ = std::max(circumscribed_radius_,
+                                         sqrt(footprint[i].x * footprint[i].x + footprint[i].y * footprint[i].y));
+    return true;
+}
+
+void AdmissibleVelocityTable::update(const std::vector<geometry_msgs::Point>& obstacles)
+{
+    // if obstacles are already closer than stop_threshold, the robot may move on as long as it does not get closer
+    double initial_distance = stop_threshold_;
+    for (unsigned int k = 0; k < obstacles.size(); k++)
+        initial_distance = std::min(initial_distance, footprint_distance_.getDistance(obstacles[k].x, obstacles[k].y));
+    double collision_distance = (initial_distance < stop_threshold_) ? initial_distance - DISTANCE_TOLERANCE
+                                                                     : stop_threshold_;
+
+    for (unsigned int j = 0; j < nr_elevation_; j++)
+    {
+        double elevation = -M_PI / 2.0 + j * M_PI / (nr_elevation_ - 1);
+        for (unsigned int i = 0; i < nr_azimuth_; i++)
+        {
+            double azimuth = -M_PI + i * 2.0 * M_PI / nr_azimuth_;
+            admissible_speed_[j * nr_azimuth_ + i] = computeAdmissibleSpeed(
+                cos(elevation) * cos(azimuth), cos(elevation) * sin(azimuth), sin(elevation),
+                obstacles, collision_distance);
+        }
+    }
+}
+
+double AdmissibleVelocityTable::getScale(double vx, double vy, double vtheta) const
+{
+    if (v_max_ <= 0.0 || vtheta_max_ <= 0.0)
+        return 1.0;
+
+    double nx = vx / v_max_;
+    double ny = vy / v_max_;
+    double ntheta = vtheta / vtheta_max_;
+    double norm = sqrt(nx * nx + ny * ny + ntheta * ntheta);
+    if (norm < MIN_VELOCITY)
+        return 1.0;
+
+    // continuous table coordinates
+    double azimuth = (atan2(ny, nx) + M_PI) / (2.0 * M_PI) * nr_azimuth_;
+    double elevation = (atan2(ntheta, sqrt(nx * nx + ny * ny)) + M_PI / 2.0) / M_PI * (nr_elevation_ - 1);
+
+    unsigned int i0 = std::min((unsigned int)floor(azimuth), nr_azimuth_ - 1);
+    unsigned int i1 = (i0 + 1) % nr_azimuth_;
+    unsigned int j0 = std::min((unsigned int)floor(elevation), nr_elevation_ - 2);
+    unsigned int j1 = j0 + 1;
+
+    // interpolating could exceed the admissible speed of a neighbouring direction: use the most restrictive one
+    double speed = std::min(std::min(getEntry(i0, j0), getEntry(i1, j0)), std::min(getEntry(i0, j1), getEntry(i1, j1)));
+
+    return std::min(1.0, speed / norm);
+}
+
+double AdmissibleVelocityTable::computeAdmissibleSpeed(double nx, double ny, double ntheta,
+                                                       const std::vector<geometry_msgs::Point>& obstacles,
+                                                       double collision_distance) const
+{
+    // velocity at speed 1, the path only depends on the direction
+    double vx = nx * v_max_;
+    double vy = ny * v_max_;
+    double vtheta = ntheta * vtheta_max_;
+    double v_lin = sqrt(vx * vx + vy * vy);
+
+    // braking time at speed 1 with all axes decelerating proportionally
+    double braking_time = 0.0;
+    if (ax_max_ > 0.0)
+        braking_time = std::max(braking_time, fabs(vx) / ax_max_);
+    if (ay_max_ > 0.0)
+        braking_time = std::max(braking_time, fabs(vy) / ay_max_);
+    if (atheta_max_ > 0.0)
+        braking_time = std::max(braking_time, fabs(vtheta) / atheta_max_);
+
+    // path parameter (time at speed 1) needed to stop from speed s: s * reaction_time + s^2 * braking_time / 2
+    double max_path = MAX_ADMISSIBLE_SPEED * reaction_time_
+        + MAX_ADMISSIBLE_SPEED * MAX_ADMISSIBLE_SPEED * braking_time / 2.0;
+    double sweep_velocity = v_lin + fabs(vtheta) * (circumscribed_radius_ + stop_threshold_);
+    if (max_path <= 0.0 || sweep_velocity < MIN_VELOCITY || obstacles.empty())
+        return MAX_ADMISSIBLE_SPEED;
+
+    unsigned int nr_steps = std::min(MAX_PATH_STEPS,
+                                     (unsigned int)ceil(max_path * sweep_velocity / PATH_RESOLUTION));
+    nr_steps = std::max(nr_steps, 1u);
+    double check_radius = circumscribed_radius_ + stop_threshold_;
+
+    double free_path = max_path;
+    for (unsigned int step = 0; step <= nr_steps && free_path == max_path; step++)
+    {
+        double path = max_path * step / nr_steps;
+
+        // pose after moving along the constant twist for path
+        double theta = vtheta * path;
+        double x, y;
+        if (fabs(vtheta) < MIN_VELOCITY)
+        {
+            x = vx * path;
+            y = vy * path;
+        }
+        else
+        {
+            x = (vx * sin(theta) + vy * (cos(theta) - 1.0)) / vtheta;
+            y = (vx * (1.0 - cos(theta)) + vy * sin(theta)) / vtheta;
+        }
+        double cos_theta = cos(theta);
+        double sin_theta = sin(theta);
+
+        for (unsigned int k = 0; k < obstacles.size(); k++)
+        {
+            double dx = obstacles[k].x - x;
+            double dy = obstacles[k].y - y;
+            if (dx * dx + dy * dy > check_radius * check_radius)
+                continue;
+
+            double distance = footprint_distance_.getDistance(cos_theta * dx + sin_theta * dy,
+                                                              -sin_theta * dx + cos_theta * dy);
+            if (distance < collision_distance)
+            {
+                free_path = (step > 0) ? max_path * (step - 1) / nr_steps : 0.0;
+                break;
+            }
+        }
+    }
+
+    if (free_path >= max_path)
+        return MAX_ADMISSIBLE_SPEED;
+
+    // invert free_path = s * reaction_time + s^2 * braking_time / 2
+    if (braking_time > MIN_VELOCITY)
+        return (-reaction_time_ + sqrt(reaction_time_ * reaction_time_ + 2.0 * braking_time * free_path))
+            / braking_time;
+    return free_path / reaction_time_;
+}
+
+double AdmissibleVelocityTable::getEntry(unsigned int azimuth, unsigned int elevation) const
+{
+    return admissible_speed_[elevation * nr_azimuth_ + azimuth];
+}
+
+}
@@ -0,0 +1,616 @@
+/*
+ * Copyright 2017 Fraunhofer Institute for Manufacturing Engineering and Automation (IPA)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <collision_filter_core.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <ros/console.h>
+
+
+namespace cob_collision_velocity_filter
+{
+
+//cells on the tube border are counted as inside, independent of rounding in the lateral offset [m]
+const double TUBE_BORDER_TOLERANCE = 1e-6;
+
+CollisionFilterCore::CollisionFilterCore()
+{
+  footprint_front_ = 0.0;
+  footprint_rear_ = 0.0;
+  footprint_left_ = 0.0;
+  footprint_right_ = 0.0;
+  closest_obstacle_dist_ = parameters_.influence_radius;
+  closest_obstacle_angle_ = 0.0;
+  lookup_tables_valid_ = false;
+  costmap_version_ = 0;
+  snapshot_row_min_ = snapshot_col_min_ = -1;
+  snapshot_width_ = snapshot_height_ = snapshot_size_x_ = 0;
+  occupied_cells_radius_ = -1.0;
+  evaluated_circumscribed_radius_ = -1.0;
+  evaluation_version_ = 0;
+  vx_last_ = 0.0;
+  vy_last_ = 0.0;
+  vtheta_last_ = 0.0;
+}
+
+CollisionFilterCore::~CollisionFilterCore()
+{
+}
+
+void CollisionFilterCore::setParameters(const CollisionFilterParameters& parameters)
+{
+  parameters_ = parameters;
+}
+
+const CollisionFilterParameters& CollisionFilterCore::getParameters() const
+{
+  return parameters_;
+}
+
+void CollisionFilterCore::setFootprint(const std::vector<geometry_msgs::Point>& footprint)
+{
+  footprint_front_ = 0.0;
+  footprint_rear_ = 0.0;
+  footprint_left_ = 0.0;
+  footprint_right_ = 0.0;
+
+  robot_footprint_ = footprint;
+  for (unsigned int i = 0; i < footprint.size(); i++)
+  {
+    if (footprint[i].x > footprint_front_)
+      footprint_front_ = footprint[i].x;
+    if (footprint[i].x < footprint_rear_)
+      footprint_rear_ = footprint[i].x;
+    if (footprint[i].y > footprint_left_)
+      footprint_left_ = footprint[i].y;
+    if (footprint[i].y < footprint_right_)
+      footprint_right_ = footprint[i].y;
+  }
+}
+
+void CollisionFilterCore::stop()
+{
+  vx_last_ = 0.0;
+  vy_last_ = 0.0;
+  vtheta_last_ = 0.0;
+}
+
+double CollisionFilterCore::getClosestObstacleDistance() const
+{
+  return closest_obstacle_dist_;
+}
+
+double CollisionFilterCore::getClosestObstacleAngle() const
+{
+  return closest_obstacle_angle_;
+}
+
+const std::vector<unsigned int>& CollisionFilterCore::getRelevantCells() const
+{
+  return relevant_cells_;
+}
+
+unsigned int CollisionFilterCore::getEvaluationVersion() const
+{
+  return evaluation_version_;
+}
+
+// sets corrected velocity of joystick command
+bool CollisionFilterCore::computeCommand(const geometry_msgs::Twist& twist, double dt, geometry_msgs::Twist& cmd_vel)
+{
+  double vx_max, vy_max;
+
+  cmd_vel = twist;
+
+  double vel_angle = atan2(cmd_vel.linear.y, cmd_vel.linear.x);
+  vx_max = parameters_.v_max * fabs(cos(vel_angle));
+  if (vx_max > fabs(cmd_vel.linear.x))
+    vx_max = fabs(cmd_vel.linear.x);
+  vy_max = parameters_.v_max * fabs(sin(vel_angle));
+  if (vy_max > fabs(cmd_vel.linear.y))
+    vy_max = fabs(cmd_vel.linear.y);
+
+  if (parameters_.use_dynamic_window)
+  {
+    //Limit to the max admissible speed in the commanded direction:
+    double admissible_scale = admissible_velocities_.getScale(cmd_vel.linear.x, cmd_vel.linear.y, cmd_vel.angular.z);
+    cmd_vel.linear.x *= admissible_scale;
+    cmd_vel.linear.y *= admissible_scale;
+    cmd_vel.angular.z *= admissible_scale;
+  }
+  //Slow down in any way while approximating an obstacle:
+  else if (closest_obstacle_dist_ < parameters_.influence_radius)
+  {
+    double F_x, F_y;
+    double vx_d, vy_d, vx_factor, vy_factor;
+    double kv_obst = parameters_.kv, vx_max_obst = vx_max, vy_max_obst = vy_max;
+
+    //implementation for linear decrease of v_max:
+    double obstacle_linear_slope_x = vx_max / (parameters_.obstacle_damping_dist - parameters_.stop_threshold);
+    vx_max_obst = (closest_obstacle_dist_ - parameters_.stop_threshold + parameters_.stop_threshold / 10.0f)
+        * obstacle_linear_slope_x;
+    if (vx_max_obst > vx_max)
+      vx_max_obst = vx_max;
+    else if (vx_max_obst < 0.0f)
+      vx_max_obst = 0.0f;
+
+    double obstacle_linear_slope_y = vy_max / (parameters_.obstacle_damping_dist - parameters_.stop_threshold);
+    vy_max_obst = (closest_obstacle_dist_ - parameters_.stop_threshold + parameters_.stop_threshold / 10.0f)
+        * obstacle_linear_slope_y;
+    if (vy_max_obst > vy_max)
+      vy_max_obst = vy_max;
+    else if (vy_max_obst < 0.0f)
+      vy_max_obst = 0.0f;
+
+    //Translational movement
+    //calculation of v factor to limit maxspeed
+    double closest_obstacle_dist_x = closest_obstacle_dist_ * cos(closest_obstacle_angle_);
+    double closest_obstacle_dist_y = closest_obstacle_dist_ * sin(closest_obstacle_angle_);
+    vx_d = parameters_.kp / kv_obst * closest_obstacle_dist_x;
+    vy_d = parameters_.kp / kv_obst * closest_obstacle_dist_y;
+    vx_factor = vx_max_obst / sqrt(vy_d * vy_d + vx_d * vx_d);
+    vy_factor = vy_max_obst / sqrt(vy_d * vy_d + vx_d * vx_d);
+    if (vx_factor > 1.0)
+      vx_factor = 1.0;
+    if (vy_factor > 1.0)
+      vy_factor = 1.0;
+
+    F_x = -kv_obst * vx_last_ + vx_factor * parameters_.kp * closest_obstacle_dist_x;
+    F_y = -kv_obst * vy_last_ + vy_factor * parameters_.kp * closest_obstacle_dist_y;
+
+    cmd_vel.linear.x = vx_last_ + F_x / parameters_.virt_mass * dt;
+    cmd_vel.linear.y = vy_last_ + F_y / parameters_.virt_mass * dt;
+
+  }
+
+  // make sure, the computed and commanded velocities are not greater than the specified max velocities
+  if (fabs(cmd_vel.linear.x) > vx_max)
+    cmd_vel.linear.x = sign(cmd_vel.linear.x) * vx_max;
+  if (fabs(cmd_vel.linear.y) > vy_max)
+    cmd_vel.linear.y = sign(cmd_vel.linear.y) * vy_max;
+  if (fabs(cmd_vel.angular.z) > parameters_.vtheta_max)
+    cmd_vel.angular.z = sign(cmd_vel.angular.z) * parameters_.vtheta_max;
+
+  // limit acceleration:
+  // only acceleration (in terms of speeding up in any direction) is limited,
+  // deceleration (in terms of slowing down) is handeled either by cob_teleop or the potential field
+  // like slow-down behaviour above
+  if (fabs(cmd_vel.linear.x) > fabs(vx_last_))
+  {
+    if ((cmd_vel.linear.x - vx_last_) / dt > parameters_.ax_max)
+      cmd_vel.linear.x = vx_last_ + parameters_.ax_max * dt;
+    else if ((cmd_vel.linear.x - vx_last_) / dt < -parameters_.ax_max)
+      cmd_vel.linear.x = vx_last_ - parameters_.ax_max * dt;
+  }
+  if (fabs(cmd_vel.linear.y) > fabs(vy_last_))
+  {
+    if ((cmd_vel.linear.y - vy_last_) / dt > parameters_.ay_max)
+      cmd_vel.linear.y = vy_last_ + parameters_.ay_max * dt;
+    else if ((cmd_vel.linear.y - vy_last_) / dt < -parameters_.ay_max)
+      cmd_vel.linear.y = vy_last_ - parameters_.ay_max * dt;
+  }
+  if (fabs(cmd_vel.angular.z) > fabs(vtheta_last_))
+  {
+    if ((cmd_vel.angular.z - vtheta_last_) / dt > parameters_.atheta_max)
+      cmd_vel.angular.z = vtheta_last_ + parameters_.atheta_max * dt;
+    else if ((cmd_vel.angular.z - vtheta_last_) / dt < -parameters_.atheta_max)
+      cmd_vel.angular.z = vtheta_last_ - parameters_.atheta_max * dt;
+  }
+
+  vx_last_ = cmd_vel.linear.x;
+  vy_last_ = cmd_vel.linear.y;
+  vtheta_last_ = cmd_vel.angular.z;
+
+  // if closest obstacle is within stop_threshold, then do not move
+  // (also with the dynamic window, as a backstop for the discretization of the table)
+  return closest_obstacle_dist_ >= parameters_.stop_threshold;
+}
+
+bool CollisionFilterCore::evaluateObstacles(const CostmapView& costmap, const geometry_msgs::Twist& twist)
+{
+  double cur_distance_to_center, cur_distance_to_border;
+  double obstacle_theta_robot, obstacle_dist_vel_dir;
+  bool cur_obstacle_relevant;
+  bool use_circumscribed = true, use_tube = true;
+
+  double corner_dist, circumscribed_radius = 0.0f;
+  for (unsigned i = 0; i < robot_footprint_.size(); i++)
+  {
+    corner_dist = sqrt(robot_footprint_[i].x * robot_footprint_[i].x + robot_footprint_[i].y * robot_footprint_[i].y);
+    if (corner_dist > circumscribed_radius)
+      circumscribed_radius = corner_dist;
+  }
+
+  //track the costmap: tables and occupied cells are only rebuilt if the costmap, the footprint or the radii changed
+  bool tables_changed = updateLookupTables(costmap.size_x, costmap.size_y, costmap.resolution, costmap.origin_x,
+                                           costmap.origin_y);
+  bool obstacles_changed = updateOccupiedCells(costmap, std::max(circumscribed_radius, parameters_.influence_radius),
+                                               tables_changed);
+
+  //velocity space admissibility is recomputed per costmap version, not per command
+  if (parameters_.use_dynamic_window)
+  {
+    std::vector<geometry_msgs::Point> footprint = robot_footprint_;
+    if (!parameters_.use_polygon_footprint || footprint.size() < 3)
+    {
+      footprint.resize(4);
+      footprint[0].x = footprint_front_;
+      footprint[0].y = footprint_left_;
+      footprint[1].x = footprint_rear_;
+      footprint[1].y = footprint_left_;
+      footprint[2].x = footprint_rear_;
+      footprint[2].y = footprint_right_;
+      footprint[3].x = footprint_front_;
+      footprint[3].y = footprint_right_;
+    }
+    bool limits_changed = admissible_velocities_.setLimits(parameters_.v_max, parameters_.vtheta_max,
+                                                           parameters_.ax_max, parameters_.ay_max,
+                                                           parameters_.atheta_max,
+                                                           parameters_.dynamic_window_reaction_time,
+                                                           parameters_.stop_threshold);
+    bool footprint_changed = admissible_velocities_.setFootprint(footprint);
+    if (obstacles_changed || limits_changed || footprint_changed)
+    {
+      std::vector<geometry_msgs::Point> obstacles(occupied_cells_.size());
+      for (unsigned int k = 0; k < occupied_cells_.size(); k++)
+      {
+        obstacles[k].x = occupied_cells_[k].x;
+        obstacles[k].y = occupied_cells_[k].y;
+      }
+      admissible_velocities_.update(obstacles);
+    }
+  }
+
+  //nothing to do if neither the obstacles nor the command changed since the last evaluation
+  if (!obstacles_changed && circumscribed_radius == evaluated_circumscribed_radius_
+      && twist.linear.x == evaluated_twist_.linear.x && twist.linear.y == evaluated_twist_.linear.y
+      && twist.angular.z == evaluated_twist_.angular.z)
+  {
+    return false;
+  }
+
+  closest_obstacle_dist_ = parameters_.influence_radius;
+
+  //Decide, whether circumscribed or tube argument should be used for filtering:
+  if (fabs(twist.linear.x) <= 0.005f && fabs(twist.linear.y) <= 0.005f)
+  {
+    use_tube = false;
+    //disable tube filter at very slow velocities
+  }
+  if (!use_tube)
+  {
+    if (fabs(twist.angular.z) <= 0.01f)
+    {
+      use_circumscribed = false;
+    } //when tube filter inactive, start circumscribed filter at very low rot-velocities
+  }
+  else
+  {
+    if (fabs(twist.angular.z) <= parameters_.use_circumscribed_threshold)
+    {
+      use_circumscribed = false;
+    } //when tube filter running, disable circum-filter in a wider range of rot-velocities
+  }
+
+  //Calculation of tube in driving-dir considered for obstacle avoidence
+  double velocity_angle = 0.0f, velocity_ortho_angle;
+  double cos_velocity_angle = 1.0f, sin_velocity_angle = 0.0f;
+  double corner_angle, delta_corner_angle;
+  double ortho_corner_dist;
+  double tube_left_border = 0.0f, tube_right_border = 0.0f;
+  double tube_left_origin = 0.0f, tube_right_origin = 0.0f;
+
+  if (use_tube)
+  {
+    //use commanded vel-value for vel-vector direction.. ?
+    velocity_angle = atan2(twist.linear.y, twist.linear.x);
+    velocity_ortho_angle = velocity_angle + M_PI / 2.0f;
+    cos_velocity_angle = cos(velocity_angle);
+    sin_velocity_angle = sin(velocity_angle);
+
+    for (unsigned i = 0; i < robot_footprint_.size(); i++)
+    {
+      corner_angle = atan2(robot_footprint_[i].y, robot_footprint_[i].x);
+      delta_corner_angle = velocity_ortho_angle - corner_angle;
+      corner_dist = sqrt(robot_footprint_[i].x * robot_footprint_[i].x + robot_footprint_[i].y * robot_footprint_[i].y);
+      ortho_corner_dist = cos(delta_corner_angle) * corner_dist;
+
+      if (ortho_corner_dist < tube_right_border)
+      {
+        tube_right_border = ortho_corner_dist;
+        tube_right_origin = sin(delta_corner_angle) * corner_dist;
+      }
+      else if (ortho_corner_dist > tube_left_border)
+      {
+        tube_left_border = ortho_corner_dist;
+        tube_left_origin = sin(delta_corner_angle) * corner_dist;
+      }
+    }
+  }
+
+  //find relevant obstacles among the occupied cells of the current costmap
+  relevant_cells_.clear();
+
+  for (unsigned int k = 0; k < occupied_cells_.size() && (use_circumscribed || use_tube); k++)
+  {
+    const OccupiedCell& cell = occupied_cells_[k];
+
+    cur_distance_to_center = cell_range_[cell.index];
+    const bool in_circumscribed = use_circumscribed && cur_distance_to_center <= circumscribed_radius;
+    const bool in_influence = use_tube && cur_distance_to_center < parameters_.influence_radius;
+    if (!in_circumscribed && !in_influence)
+      continue;
+
+    cur_obstacle_relevant = false;
+    obstacle_theta_robot = cell_angle_[cell.index];
+    //check whether current obstacle lies inside the circumscribed_radius of the robot -> prevent collisions while rotating
+    if (in_circumscribed)
+    {
+      cur_obstacle_relevant = true;
+    }
+    else
+    {
+      //for each obstacle, now check whether it lies in the tube or not:
+      //lateral and longitudinal offset to the driving direction, i.e. sin/cos of the angle difference times range
+      obstacle_dist_vel_dir = cell.y * cos_velocity_angle - cell.x * sin_velocity_angle;
+
+      if (obstacle_dist_vel_dir <= tube_left_border + TUBE_BORDER_TOLERANCE
+          && obstacle_dist_vel_dir >= tube_right_border - TUBE_BORDER_TOLERANCE)
+      {
+        //found obstacle that lies inside of observation tube
+        const double obstacle_dist_along_vel_dir = cell.x * cos_velocity_angle + cell.y * sin_velocity_angle;
+
+        if (sign(obstacle_dist_vel_dir) >= 0)
+        {
+          if (obstacle_dist_along_vel_dir >= tube_left_origin - TUBE_BORDER_TOLERANCE)
+          {
+            //relevant obstacle in tube found
+            cur_obstacle_relevant = true;
+          }
+        }
+        else
+        { // obstacle in right part of tube
+          if (obstacle_dist_along_vel_dir >= tube_right_origin - TUBE_BORDER_TOLERANCE)
+          {
+            //relevant obstacle in tube found
+            cur_obstacle_relevant = true;
+          }
+        }
+      }
+    }
+
+    if (cur_obstacle_relevant)
+    {
+      ROS_DEBUG_STREAM_NAMED("obstacleHandler", "[cob_collision_velocity_filter] Detected an obstacle");
+      //relevant obstacle in tube found
+      relevant_cells_.push_back(cell.index);
+
+      //distance of current, relevant obstacle to the robot border
+      cur_distance_to_border = cell_border_dist_[cell.index];
+      if (cur_distance_to_border < closest_obstacle_dist_)
+      {
+        closest_obstacle_dist_ = cur_distance_to_border;
+        closest_obstacle_angle_ = obstacle_theta_robot;
+      }
+    }
+  }
+
+  evaluated_twist_ = twist;
+  evaluated_circumscribed_radius_ = circumscribed_radius;
+  evaluation_version_++;
+
+  ROS_DEBUG_STREAM_NAMED("obstacleHandler",
+                         "[cob_collision_velocity_filter] closest_obstacle_dist_ = " << closest_obstacle_dist_);
+  return true;
+}
+
+bool CollisionFilterCore::updateOccupiedCells(const CostmapView& costmap, double radius,
+                                                  bool tables_changed)
+{
+  const unsigned char* char_map = costmap.data;
+  const unsigned int size_x = costmap.size_x;
+  const unsigned int size_y = costmap.size_y;
+  const double resolution = costmap.resolution;
+  const double origin_x = costmap.origin_x;
+  const double origin_y = costmap.origin_y;
+
+  //bounding box of the region of interest in cells, clamped to the costmap
+  int row_min = 0, row_max = -1, col_min = 0, col_max = -1;
+  if (size_x > 0 && size_y > 0 && resolution > 0.0f)
+  {
+    row_min = std::max(0, (int)floor((-radius - origin_y) / resolution));
+    row_max = std::min((int)size_y - 1, (int)ceil((radius - origin_y) / resolution));
+    col_min = std::max(0, (int)floor((-radius - origin_x) / resolution));
+    col_max = std::min((int)size_x - 1, (int)ceil((radius - origin_x) / resolution));
+  }
+
+  //the costmap does not expose an update counter, so a new version is detected by comparing the region of interest
+  //against the last one; cells outside of it cannot be relevant
+  const unsigned int roi_width = col_max >= col_min ? col_max - col_min + 1 : 0;
+  const unsigned int roi_height = row_max >= row_min ? row_max - row_min + 1 : 0;
+  bool costmap_changed = row_min != snapshot_row_min_ || col_min != snapshot_col_min_
+      || roi_width != snapshot_width_ || roi_height != snapshot_height_ || size_x != snapshot_size_x_;
+  for (unsigned int r = 0; !costmap_changed && r < roi_height; r++)
+    costmap_changed = memcmp(&costmap_snapshot_[r * roi_width], char_map + (row_min + r) * size_x + col_min, roi_width) != 0;
+
+  if (!costmap_changed && !tables_changed && radius == occupied_cells_radius_)
+    return false;
+
+  if (costmap_changed)
+  {
+    costmap_snapshot_.resize(roi_width * roi_height);
+    for (unsigned int r = 0; r < roi_height; r++)
+      memcpy(&costmap_snapshot_[r * roi_width], char_map + (row_min + r) * size_x + col_min, roi_width);
+    snapshot_row_min_ = row_min;
+    snapshot_col_min_ = col_min;
+    snapshot_width_ = roi_width;
+    snapshot_height_ = roi_height;
+    snapshot_size_x_ = size_x;
+    costmap_version_++;
+    ROS_DEBUG_NAMED("obstacleHandler", "[cob_collision_velocity_filter] New costmap version %u", costmap_version_);
+  }
+
+  //only cells within the circumscribed circle (rotation) or the influence circle (tube) can be relevant
+  const double radius_sq = radius * radius;
+  occupied_cells_.clear();
+  occupied_cells_radius_ = radius;
+
+  for (int row = row_min; row <= row_max; row++)
+  {
+    const double cell_y = row * resolution + origin_y;
+    const double cell_y_sq = cell_y * cell_y;
+    if (cell_y_sq > radius_sq)
+      continue;
+
+    //columns of this row that lie inside the region of interest
+    const double half_chord = sqrt(radius_sq - cell_y_sq);
+    const int col_min = std::max(0, (int)floor((-half_chord - origin_x) / resolution));
+    const int col_max = std::min((int)size_x - 1, (int)ceil((half_chord - origin_x) / resolution));
+    const unsigned int row_offset = row * size_x;
+
+    for (int col = col_min; col <= col_max; col++)
+    {
+      const unsigned int i = row_offset + col;
+      if (char_map[i] < parameters_.costmap_obstacle_treshold || cell_range_[i] > radius)
+        continue;
+
+      // cell in 2D space where robot is is point (0, 0)
+      OccupiedCell cell;
+      cell.index = i;
+      cell.x = col * resolution + origin_x;
+      cell.y = cell_y;
+      if (obstacleValid(cell.x, cell.y))
+        occupied_cells_.push_back(cell);
+    }
+  }
+
+  return true;
+}
+
+bool CollisionFilterCore::updateLookupTables(unsigned int size_x, unsigned int size_y, double resolution,
+                                                 double origin_x, double origin_y)
+{
+  bool geometry_changed = !lookup_tables_valid_ || size_x != table_size_x_ || size_y != table_size_y_
+      || resolution != table_resolution_ || origin_x != table_origin_x_ || origin_y != table_origin_y_;
+  bool footprint_changed = !lookup_tables_valid_ || footprint_front_ != table_footprint_front_
+      || footprint_rear_ != table_footprint_rear_ || footprint_left_ != table_footprint_left_
+      || footprint_right_ != table_footprint_right_;
+  if (parameters_.use_polygon_footprint && footprint_distance_.setPolygon(robot_footprint_))
+    footprint_changed = true;
+  if (!geometry_changed && !footprint_changed)
+    return false;
+
+  const unsigned int nr_cells = size_x * size_y;
+  if (geometry_changed)
+  {
+    ROS_DEBUG("[cob_collision_velocity_filter] Rebuild polar lookup tables for %u x %u cells", size_x, size_y);
+    cell_range_.resize(nr_cells);
+    cell_angle_.resize(nr_cells);
+    for (unsigned int i = 0; i < nr_cells; i++)
+    {
+      double cell_x = (i % size_x) * resolution + origin_x;
+      double cell_y = (i / size_x) * resolution + origin_y;
+      cell_range_[i] = sqrt(cell_x * cell_x + cell_y * cell_y);
+      cell_angle_[i] = atan2(cell_y, cell_x);
+    }
+  }
+
+  //Calculate corner angles in robot_frame:
+  double corner_front_left, corner_rear_left, corner_rear_right, corner_front_right;
+  corner_front_left = atan2(footprint_left_, footprint_front_);
+  corner_rear_left = atan2(footprint_left_, footprint_rear_);
+  corner_rear_right = atan2(footprint_right_, footprint_rear_);
+  corner_front_right = atan2(footprint_right_, footprint_front_);
+
+  cell_border_dist_.resize(nr_cells);
+  for (unsigned int i = 0; i < nr_cells; i++)
+  {
+    double theta = cell_angle_[i];
+    if (parameters_.use_polygon_footprint && footprint_distance_.isValid())
+    {
+      //exact distance to the footprint polygon:
+      cell_border_dist_[i] = footprint_distance_.getDistance((i % size_x) * resolution + origin_x,
+                                                             (i / size_x) * resolution + origin_y);
+    }
+    else if (theta >= corner_front_right && theta < corner_front_left)
+    {
+      //obstacle in front:
+      cell_border_dist_[i] = cell_range_[i] - fabs(footprint_front_) / fabs(cos(theta));
+    }
+    else if (theta >= corner_front_left && theta < corner_rear_left)
+    {
+      //obstacle left:
+      cell_border_dist_[i] = cell_range_[i] - fabs(footprint_left_) / fabs(sin(theta));
+    }
+    else if (theta >= corner_rear_left || theta < corner_rear_right)
+    {
+      //obstacle in rear:
+      cell_border_dist_[i] = cell_range_[i] - fabs(footprint_rear_) / fabs(cos(theta));
+    }
+    else
+    {
+      //obstacle right:
+      cell_border_dist_[i] = cell_range_[i] - fabs(footprint_right_) / fabs(sin(theta));
+    }
+  }
+
+  table_size_x_ = size_x;
+  table_size_y_ = size_y;
+  table_resolution_ = resolution;
+  table_origin_x_ = origin_x;
+  table_origin_y_ = origin_y;
+  table_footprint_front_ = footprint_front_;
+  table_footprint_rear_ = footprint_rear_;
+  table_footprint_left_ = footprint_left_;
+  table_footprint_right_ = footprint_right_;
+  lookup_tables_valid_ = true;
+  return true;
+}
+
+double CollisionFilterCore::sign(double x)
+{
+  if (x >= 0.0f)
+    return 1.0f;
+  else
+    return -1.0f;
+}
+
+bool CollisionFilterCore::obstacleValid(double x_obstacle, double y_obstacle)
+{
+  if (parameters_.use_polygon_footprint && footprint_distance_.isValid())
+  {
+    if (footprint_distance_.isInside(x_obstacle, y_obstacle))
+    {
+      ROS_WARN("Found an obstacle inside robot_footprint: Skip!");
+      return false;
+    }
+    return true;
+  }
+
+  if (x_obstacle < footprint_front_ && x_obstacle > footprint_rear_ && y_obstacle > footprint_right_
+      && y_obstacle < footprint_left_)
+  {
+    ROS_WARN("Found an obstacle inside robot_footprint: Skip!");
+    return false;
+  }
+
+  return true;
+}
+
+}
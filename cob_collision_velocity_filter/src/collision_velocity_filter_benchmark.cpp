@@ -0,0 +1,781 @@
+/*
+ * Copyright 2017 Fraunhofer Institute for Manufacturing Engineering and Automation (IPA)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// Offline benchmark and replay of the collision velocity filter core.
+//
+// Without arguments, synthetic costmaps of several sizes and resolutions are generated together with a command
+// stream (commands arrive faster than costmap updates). With --bag, the anti collision costmap (OccupancyGrid)
+// and the commands (Twist) recorded in a bag file are replayed instead.
+//
+// For every command the latency of obstacle evaluation and command computation is measured and the output is
+// checked against the reference implementation (full costmap scan with trigonometry per cell and the controller
+// step as before the filter core was introduced). Both the closest obstacle distance and the published command are
+// compared, differences are counted separately for both directions. The exact polygon footprint distance is
+// compared against the rectangle model.
+//
+
+#include <collision_filter_core.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <ros/ros.h>
+#ifdef HAVE_ROSBAG
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+#endif
+#include <nav_msgs/OccupancyGrid.h>
+#include <geometry_msgs/Twist.h>
+
+using cob_collision_velocity_filter::CollisionFilterCore;
+using cob_collision_velocity_filter::CollisionFilterParameters;
+using cob_collision_velocity_filter::CostmapView;
+
+namespace
+{
+
+const double COMMAND_PERIOD = 0.02;       // 50 Hz command stream
+const double EQUIVALENCE_TOLERANCE = 1e-6;
+
+///
+/// @brief  collects latency samples and prints their distribution
+///
+class LatencyStatistics
+{
+public:
+  void add(double seconds)
+  {
+    samples_.push_back(seconds * 1e6);
+  }
+
+  void print(const std::string& name)
+  {
+    if (samples_.empty())
+    {
+      printf("  %-28s no samples\n", name.c_str());
+      return;
+    }
+    std::sort(samples_.begin(), samples_.end());
+    double sum = 0.0;
+    for (unsigned int i = 0; i < samples_.size(); i++)
+      sum += samples_[i];
+    printf("  %-28s n=%-6u mean=%9.2f min=%9.2f p50=%9.2f p90=%9.2f p99=%9.2f max=%9.2f [us]\n", name.c_str(),
+           (unsigned int)samples_.size(), sum / samples_.size(), samples_.front(), percentile(0.5), percentile(0.9),
+           percentile(0.99), samples_.back());
+  }
+
+private:
+  double percentile(double p) const
+  {
+    return samples_[std::min((size_t)(p * samples_.size()), samples_.size() - 1)];
+  }
+
+  std::vector<double> samples_;
+};
+
+///
+/// @brief  the filter as implemented before the core was introduced: full costmap scan with trigonometry
+///         per cell
+///
+class ReferenceFilter
+{
+public:
+  ReferenceFilter(const CollisionFilterParameters& parameters, const std::vector<geometry_msgs::Point>& footprint)
+  : parameters_(parameters),
+    footprint_(footprint)
+  {
+    front_ = rear_ = left_ = right_ = 0.0;
+    for (unsigned int i = 0; i < footprint.size(); i++)
+    {
+      front_ = std::max(front_, footprint[i].x);
+      rear_ = std::min(rear_, footprint[i].x);
+      left_ = std::max(left_, footprint[i].y);
+      right_ = std::min(right_, footprint[i].y);
+    }
+    closest_obstacle_dist_ = parameters.influence_radius;
+    closest_obstacle_angle_ = 0.0;
+    vx_last_ = vy_last_ = vtheta_last_ = 0.0;
+  }
+
+  void evaluateObstacles(const CostmapView& costmap, const geometry_msgs::Twist& twist)
+  {
+    closest_obstacle_dist_ = parameters_.influence_radius;
+
+    double corner_front_left = atan2(left_, front_);
+    double corner_rear_left = atan2(left_, rear_);
+    double corner_rear_right = atan2(right_, rear_);
+    double corner_front_right = atan2(right_, front_);
+
+    bool use_circumscribed = true, use_tube = true;
+    if (fabs(twist.linear.x) <= 0.005f && fabs(twist.linear.y) <= 0.005f)
+      use_tube = false;
+    if (!use_tube)
+    {
+      if (fabs(twist.angular.z) <= 0.01f)
+        use_circumscribed = false;
+    }
+    else if (fabs(twist.angular.z) <= parameters_.use_circumscribed_threshold)
+    {
+      use_circumscribed = false;
+    }
+
+    double velocity_angle = 0.0f;
+    double tube_left_border = 0.0f, tube_right_border = 0.0f;
+    double tube_left_origin = 0.0f, tube_right_origin = 0.0f;
+    double circumscribed_radius = 0.0f;
+    for (unsigned i = 0; i < footprint_.size(); i++)
+      circumscribed_radius = std::max(circumscribed_radius, hypot(footprint_[i].x, footprint_[i].y));
+
+    if (use_tube)
+    {
+      velocity_angle = atan2(twist.linear.y, twist.linear.x);
+      double velocity_ortho_angle = velocity_angle + M_PI / 2.0f;
+      for (unsigned i = 0; i < footprint_.size(); i++)
+      {
+        double corner_angle = atan2(footprint_[i].y, footprint_[i].x);
+        double delta_corner_angle = velocity_ortho_angle - corner_angle;
+        double corner_dist = hypot(footprint_[i].x, footprint_[i].y);
+        double ortho_corner_dist = cos(delta_corner_angle) * corner_dist;
+        if (ortho_corner_dist < tube_right_border)
+        {
+          tube_right_border = ortho_corner_dist;
+          tube_right_origin = sin(delta_corner_angle) * corner_dist;
+        }
+        else if (ortho_corner_dist > tube_left_border)
+        {
+          tube_left_border = ortho_corner_dist;
+          tube_left_origin = sin(delta_corner_angle) * corner_dist;
+        }
+      }
+    }
+
+    for (unsigned int i = 0; i < costmap.size_x * costmap.size_y; i++)
+    {
+      if (costmap.data[i] < parameters_.costmap_obstacle_treshold)
+        continue;
+
+      double x = (i % costmap.size_x) * costmap.resolution + costmap.origin_x;
+      double y = (i / costmap.size_x) * costmap.resolution + costmap.origin_y;
+      double distance_to_center = sqrt(pow(x, 2) + pow(y, 2));
+      bool valid = !(x < front_ && x > rear_ && y > right_ && y < left_);
+      bool relevant = false;
+      double theta = 0.0;
+
+      if (use_circumscribed && distance_to_center <= circumscribed_radius)
+      {
+        if (valid)
+        {
+          relevant = true;
+          theta = atan2(y, x);
+        }
+      }
+      else if (use_tube && distance_to_center < parameters_.influence_radius && valid)
+      {
+        theta = atan2(y, x);
+        double delta_theta = theta - velocity_angle;
+        double dist_vel_dir = sin(delta_theta) * distance_to_center;
+        if (dist_vel_dir <= tube_left_border && dist_vel_dir >= tube_right_border)
+        {
+          double origin = (dist_vel_dir >= 0) ? tube_left_origin : tube_right_origin;
+          relevant = (cos(delta_theta) * distance_to_center >= origin);
+        }
+      }
+
+      if (!relevant)
+        continue;
+
+      double distance_to_border;
+      if (theta >= corner_front_right && theta < corner_front_left)
+        distance_to_border = distance_to_center - fabs(front_) / fabs(cos(theta));
+      else if (theta >= corner_front_left && theta < corner_rear_left)
+        distance_to_border = distance_to_center - fabs(left_) / fabs(sin(theta));
+      else if (theta >= corner_rear_left || theta < corner_rear_right)
+        distance_to_border = distance_to_center - fabs(rear_) / fabs(cos(theta));
+      else
+        distance_to_border = distance_to_center - fabs(right_) / fabs(sin(theta));
+
+      if (distance_to_border < closest_obstacle_dist_)
+      {
+        closest_obstacle_dist_ = distance_to_border;
+        closest_obstacle_angle_ = theta;
+      }
+    }
+  }
+
+  ///
+  /// @brief  the controller step of the node as before the core was introduced (potential field mode only)
+  /// @return the published command
+  ///
+  geometry_msgs::Twist performControllerStep(const geometry_msgs::Twist& twist, double dt)
+  {
+    double vx_max, vy_max;
+    geometry_msgs::Twist cmd_vel = twist;
+
+    double vel_angle = atan2(cmd_vel.linear.y, cmd_vel.linear.x);
+    vx_max = parameters_.v_max * fabs(cos(vel_angle));
+    if (vx_max > fabs(cmd_vel.linear.x))
+      vx_max = fabs(cmd_vel.linear.x);
+    vy_max = parameters_.v_max * fabs(sin(vel_angle));
+    if (vy_max > fabs(cmd_vel.linear.y))
+      vy_max = fabs(cmd_vel.linear.y);
+
+    //Slow down in any way while approximating an obstacle:
+    if (closest_obstacle_dist_ < parameters_.influence_radius)
+    {
+      double F_x, F_y;
+      double vx_d, vy_d, vx_factor, vy_factor;
+      double kv_obst = parameters_.kv, vx_max_obst = vx_max, vy_max_obst = vy_max;
+
+      //implementation for linear decrease of v_max:
+      double obstacle_linear_slope_x = vx_max / (parameters_.obstacle_damping_dist - parameters_.stop_threshold);
+      vx_max_obst = (closest_obstacle_dist_ - parameters_.stop_threshold + parameters_.stop_threshold / 10.0f)
+          * obstacle_linear_slope_x;
+      if (vx_max_obst > vx_max)
+        vx_max_obst = vx_max;
+      else if (vx_max_obst < 0.0f)
+        vx_max_obst = 0.0f;
+
+      double obstacle_linear_slope_y = vy_max / (parameters_.obstacle_damping_dist - parameters_.stop_threshold);
+      vy_max_obst = (closest_obstacle_dist_ - parameters_.stop_threshold + parameters_.stop_threshold / 10.0f)
+          * obstacle_linear_slope_y;
+      if (vy_max_obst > vy_max)
+        vy_max_obst = vy_max;
+      else if (vy_max_obst < 0.0f)
+        vy_max_obst = 0.0f;
+
+      //Translational movement
+      //calculation of v factor to limit maxspeed
+      double closest_obstacle_dist_x = closest_obstacle_dist_ * cos(closest_obstacle_angle_);
+      double closest_obstacle_dist_y = closest_obstacle_dist_ * sin(closest_obstacle_angle_);
+      vx_d = parameters_.kp / kv_obst * closest_obstacle_dist_x;
+      vy_d = parameters_.kp / kv_obst * closest_obstacle_dist_y;
+      vx_factor = vx_max_obst / sqrt(vy_d * vy_d + vx_d * vx_d);
+      vy_factor = vy_max_obst / sqrt(vy_d * vy_d + vx_d * vx_d);
+      if (vx_factor > 1.0)
+        vx_factor = 1.0;
+      if (vy_factor > 1.0)
+        vy_factor = 1.0;
+
+      F_x = -kv_obst * vx_last_ + vx_factor * parameters_.kp * closest_obstacle_dist_x;
+      F_y = -kv_obst * vy_last_ + vy_factor * parameters_.kp * closest_obstacle_dist_y;
+
+      cmd_vel.linear.x = vx_last_ + F_x / parameters_.virt_mass * dt;
+      cmd_vel.linear.y = vy_last_ + F_y / parameters_.virt_mass * dt;
+    }
+
+    // make sure, the computed and commanded velocities are not greater than the specified max velocities
+    if (fabs(cmd_vel.linear.x) > vx_max)
+      cmd_vel.linear.x = sign(cmd_vel.linear.x) * vx_max;
+    if (fabs(cmd_vel.linear.y) > vy_max)
+      cmd_vel.linear.y = sign(cmd_vel.linear.y) * vy_max;
+    if (fabs(cmd_vel.angular.z) > parameters_.vtheta_max)
+      cmd_vel.angular.z = sign(cmd_vel.angular.z) * parameters_.vtheta_max;
+
+    // limit acceleration
+    if (fabs(cmd_vel.linear.x) > fabs(vx_last_))
+    {
+      if ((cmd_vel.linear.x - vx_last_) / dt > parameters_.ax_max)
+        cmd_vel.linear.x = vx_last_ + parameters_.ax_max * dt;
+      else if ((cmd_vel.linear.x - vx_last_) / dt < -parameters_.ax_max)
+        cmd_vel.linear.x = vx_last_ - parameters_.ax_max * dt;
+    }
+    if (fabs(cmd_vel.linear.y) > fabs(vy_last_))
+    {
+      if ((cmd_vel.linear.y - vy_last_) / dt > parameters_.ay_max)
+        cmd_vel.linear.y = vy_last_ + parameters_.ay_max * dt;
+      else if ((cmd_vel.linear.y - vy_last_) / dt < -parameters_.ay_max)
+        cmd_vel.linear.y = vy_last_ - parameters_.ay_max * dt;
+    }
+    if (fabs(cmd_vel.angular.z) > fabs(vtheta_last_))
+    {
+      if ((cmd_vel.angular.z - vtheta_last_) / dt > parameters_.atheta_max)
+        cmd_vel.angular.z = vtheta_last_ + parameters_.atheta_max * dt;
+      else if ((cmd_vel.angular.z - vtheta_last_) / dt < -parameters_.atheta_max)
+        cmd_vel.angular.z = vtheta_last_ - parameters_.atheta_max * dt;
+    }
+
+    vx_last_ = cmd_vel.linear.x;
+    vy_last_ = cmd_vel.linear.y;
+    vtheta_last_ = cmd_vel.angular.z;
+
+    // if closest obstacle is within stop_threshold, then do not move
+    if (closest_obstacle_dist_ < parameters_.stop_threshold)
+    {
+      vx_last_ = vy_last_ = vtheta_last_ = 0.0;
+      return geometry_msgs::Twist();
+    }
+    return cmd_vel;
+  }
+
+  ///
+  /// @brief  sets the last published command (the controller state)
+  ///
+  void setLastCommand(const geometry_msgs::Twist& cmd_vel)
+  {
+    vx_last_ = cmd_vel.linear.x;
+    vy_last_ = cmd_vel.linear.y;
+    vtheta_last_ = cmd_vel.angular.z;
+  }
+
+  double getClosestObstacleDistance() const
+  {
+    return closest_obstacle_dist_;
+  }
+
+private:
+  static double sign(double x)
+  {
+    return (x >= 0.0) ? 1.0 : -1.0;
+  }
+
+  CollisionFilterParameters parameters_;
+  std::vector<geometry_msgs::Point> footprint_;
+  double front_, rear_, left_, right_;
+  double closest_obstacle_dist_, closest_obstacle_angle_;
+  double vx_last_, vy_last_, vtheta_last_;
+};
+
+///
+/// @brief  costmap buffer with its geometry
+///
+struct Costmap
+{
+  std::vector<unsigned char> data;
+  unsigned int size_x, size_y;
+  double resolution, origin_x, origin_y;
+
+  CostmapView getView() const
+  {
+    CostmapView view;
+    view.data = data.empty() ? NULL : &data[0];
+    view.size_x = size_x;
+    view.size_y = size_y;
+    view.resolution = resolution;
+    view.origin_x = origin_x;
+    view.origin_y = origin_y;
+    return view;
+  }
+};
+
+std::vector<geometry_msgs::Point> createRectangle(double front, double rear, double left, double right)
+{
+  std::vector<geometry_msgs::Point> footprint(4);
+  footprint[0].x = front;
+  footprint[0].y = left;
+  footprint[1].x = rear;
+  footprint[1].y = left;
+  footprint[2].x = rear;
+  footprint[2].y = right;
+  footprint[3].x = front;
+  footprint[3].y = right;
+  return footprint;
+}
+
+///
+/// @brief  fills a rolling window costmap with random walls and boxes outside of the footprint
+///
+void generateObstacles(std::mt19937& generator, const std::vector<geometry_msgs::Point>& footprint, Costmap& costmap)
+{
+  std::fill(costmap.data.begin(), costmap.data.end(), 0);
+  std::uniform_real_distribution<double> position(-0.5 * costmap.size_x * costmap.resolution,
+                                                  0.5 * costmap.size_x * costmap.resolution);
+  std::uniform_real_distribution<double> extent(0.05, 0.6);
+  std::uniform_int_distribution<int> nr_obstacles(3, 12);
+
+  double clearance = 0.0;
+  for (unsigned int i = 0; i < footprint.size(); i++)
+    clearance = std::max(clearance, hypot(footprint[i].x, footprint[i].y));
+
+  int n = nr_obstacles(generator);
+  for (int k = 0; k < n; k++)
+  {
+    double x0 = position(generator), y0 = position(generator);
+    double dx = extent(generator), dy = (k % 3 == 0) ? 0.05 : extent(generator);
+    for (unsigned int i = 0; i < costmap.size_x * costmap.size_y; i++)
+    {
+      double x = (i % costmap.size_x) * costmap.resolution + costmap.origin_x;
+      double y = (i / costmap.size_x) * costmap.resolution + costmap.origin_y;
+      if (x >= x0 && x <= x0 + dx && y >= y0 && y <= y0 + dy && hypot(x, y) > clearance)
+        costmap.data[i] = 254;
+    }
+  }
+}
+
+#ifdef HAVE_ROSBAG
+///
+/// @brief  converts an occupancy grid published by costmap_2d back into costmap values
+///
+void fromOccupancyGrid(const nav_msgs::OccupancyGrid& grid, Costmap& costmap)
+{
+  costmap.size_x = grid.info.width;
+  costmap.size_y = grid.info.height;
+  costmap.resolution = grid.info.resolution;
+  costmap.origin_x = grid.info.origin.position.x;
+  costmap.origin_y = grid.info.origin.position.y;
+  costmap.data.resize(grid.data.size());
+  for (unsigned int i = 0; i < grid.data.size(); i++)
+  {
+    int value = grid.data[i];
+    if (value < 0)
+      costmap.data[i] = 255;
+    else if (value >= 100)
+      costmap.data[i] = 254;
+    else if (value == 99)
+      costmap.data[i] = 253;
+    else if (value == 0)
+      costmap.data[i] = 0;
+    else
+      costmap.data[i] = (unsigned char)std::min(252.0, 1.0 + (value - 1) * 251.0 / 97.0);
+  }
+}
+#endif
+
+///
+/// @brief  runs the core and the reference filter on one command and collects latencies and differences
+///
+class Runner
+{
+public:
+  Runner(const CollisionFilterParameters& parameters, const std::vector<geometry_msgs::Point>& footprint)
+  : reference_(parameters, footprint),
+    nr_commands_(0),
+    nr_distance_larger_(0),
+    nr_distance_smaller_(0),
+    nr_command_larger_(0),
+    nr_command_smaller_(0),
+    nr_command_unexplained_(0),
+    max_distance_difference_(0.0),
+    max_command_difference_(0.0)
+  {
+    core_.setParameters(parameters);
+    core_.setFootprint(footprint);
+  }
+
+  void step(const Costmap& costmap, const geometry_msgs::Twist& twist)
+  {
+    CostmapView view = costmap.getView();
+    geometry_msgs::Twist cmd_vel;
+
+    ros::WallTime start = ros::WallTime::now();
+    core_.evaluateObstacles(view, twist);
+    if (!core_.computeCommand(twist, COMMAND_PERIOD, cmd_vel))
+    {
+      // as the node: publish a stop
+      cmd_vel = geometry_msgs::Twist();
+      core_.stop();
+    }
+    core_latency_.add((ros::WallTime::now() - start).toSec());
+
+    // the reference starts from the same state, so that a difference does not propagate to later commands
+    reference_.setLastCommand(last_cmd_vel_);
+    last_cmd_vel_ = cmd_vel;
+
+    start = ros::WallTime::now();
+    reference_.evaluateObstacles(view, twist);
+    geometry_msgs::Twist reference_cmd_vel = reference_.performControllerStep(twist, COMMAND_PERIOD);
+    reference_latency_.add((ros::WallTime::now() - start).toSec());
+
+    // larger than the reference: less conservative, smaller: more conservative
+    double difference = core_.getClosestObstacleDistance() - reference_.getClosestObstacleDistance();
+    max_distance_difference_ = std::max(max_distance_difference_, fabs(difference));
+    if (difference > EQUIVALENCE_TOLERANCE)
+      nr_distance_larger_++;
+    else if (difference < -EQUIVALENCE_TOLERANCE)
+      nr_distance_smaller_++;
+
+    // commands are compared by their magnitude per axis, with a closer obstacle the potential field may also push
+    // away from it faster: only differences without a difference in the closest distance are errors
+    double speeds[3] = { fabs(cmd_vel.linear.x) - fabs(reference_cmd_vel.linear.x),
+                         fabs(cmd_vel.linear.y) - fabs(reference_cmd_vel.linear.y),
+                         fabs(cmd_vel.angular.z) - fabs(reference_cmd_vel.angular.z) };
+    bool larger = false, smaller = false;
+    for (unsigned int i = 0; i < 3; i++)
+    {
+      max_command_difference_ = std::max(max_command_difference_, fabs(speeds[i]));
+      larger = larger || speeds[i] > EQUIVALENCE_TOLERANCE;
+      smaller = smaller || speeds[i] < -EQUIVALENCE_TOLERANCE;
+    }
+    if (larger)
+      nr_command_larger_++;
+    if (smaller)
+      nr_command_smaller_++;
+    if ((larger || smaller) && fabs(difference) <= EQUIVALENCE_TOLERANCE)
+      nr_command_unexplained_++;
+    nr_commands_++;
+  }
+
+  void print(const std::string& name)
+  {
+    printf(" %s\n", name.c_str());
+    core_latency_.print("filter core");
+    reference_latency_.print("reference (full scan)");
+    printf("  closest distance: %u of %u commands larger than the reference, %u smaller (tolerance %g m, "
+           "max difference %g m)\n", nr_distance_larger_, nr_commands_, nr_distance_smaller_, EQUIVALENCE_TOLERANCE,
+           max_distance_difference_);
+    printf("  command output:   %u of %u commands faster than the reference, %u slower, %u different at the same "
+           "distance (tolerance %g, max difference %g)\n", nr_command_larger_, nr_commands_, nr_command_smaller_,
+           nr_command_unexplained_, EQUIVALENCE_TOLERANCE, max_command_difference_);
+  }
+
+  ///
+  /// @brief  returns the number of commands with a larger closest distance than the reference or with a different
+  ///         output at the same distance
+  ///
+  unsigned int getNrMismatches() const
+  {
+    return nr_distance_larger_ + nr_command_unexplained_;
+  }
+
+private:
+  CollisionFilterCore core_;
+  ReferenceFilter reference_;
+  LatencyStatistics core_latency_, reference_latency_;
+  geometry_msgs::Twist last_cmd_vel_;
+  unsigned int nr_commands_;
+  unsigned int nr_distance_larger_, nr_distance_smaller_;
+  unsigned int nr_command_larger_, nr_command_smaller_, nr_command_unexplained_;
+  double max_distance_difference_, max_command_difference_;
+};
+
+///
+/// @brief  compares the polygon distance engine against the rectangle model on the same command stream
+///
+class FootprintModelRunner
+{
+public:
+  FootprintModelRunner(CollisionFilterParameters parameters, const std::vector<geometry_msgs::Point>& footprint)
+  : nr_commands_(0),
+    nr_not_conservative_(0),
+    sum_gain_(0.0)
+  {
+    parameters.use_polygon_footprint = false;
+    rectangle_.setParameters(parameters);
+    rectangle_.setFootprint(footprint);
+    parameters.use_polygon_footprint = true;
+    polygon_.setParameters(parameters);
+    polygon_.setFootprint(footprint);
+  }
+
+  void step(const Costmap& costmap, const geometry_msgs::Twist& twist)
+  {
+    CostmapView view = costmap.getView();
+
+    ros::WallTime start = ros::WallTime::now();
+    rectangle_.evaluateObstacles(view, twist);
+    rectangle_latency_.add((ros::WallTime::now() - start).toSec());
+
+    start = ros::WallTime::now();
+    polygon_.evaluateObstacles(view, twist);
+    polygon_latency_.add((ros::WallTime::now() - start).toSec());
+
+    // the exact distance is never larger than the distance along the ray to the rectangle border
+    double gain = rectangle_.getClosestObstacleDistance() - polygon_.getClosestObstacleDistance();
+    if (gain < -EQUIVALENCE_TOLERANCE)
+      nr_not_conservative_++;
+    sum_gain_ += gain;
+    nr_commands_++;
+  }
+
+  void print(const std::string& name)
+  {
+    printf(" %s\n", name.c_str());
+    rectangle_latency_.print("rectangle footprint");
+    polygon_latency_.print("polygon footprint");
+    printf("  closest distance rectangle - polygon: mean %g m, %u of %u commands with polygon distance larger\n",
+           nr_commands_ ? sum_gain_ / nr_commands_ : 0.0, nr_not_conservative_, nr_commands_);
+  }
+
+private:
+  CollisionFilterCore rectangle_, polygon_;
+  LatencyStatistics rectangle_latency_, polygon_latency_;
+  unsigned int nr_commands_, nr_not_conservative_;
+  double sum_gain_;
+};
+
+///
+/// @brief  random walk of commands, repeating each command a few times like a joystick at 50 Hz
+///
+geometry_msgs::Twist nextCommand(std::mt19937& generator, const CollisionFilterParameters& parameters,
+                                 const geometry_msgs::Twist& last)
+{
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  if (uniform(generator) < 0.5)
+    return last;
+
+  geometry_msgs::Twist twist;
+  twist.linear.x = parameters.v_max * (2.0 * uniform(generator) - 1.0);
+  twist.linear.y = (uniform(generator) < 0.5) ? 0.0 : parameters.v_max * (2.0 * uniform(generator) - 1.0);
+  twist.angular.z = (uniform(generator) < 0.5) ? 0.0 : parameters.vtheta_max * (2.0 * uniform(generator) - 1.0);
+  return twist;
+}
+
+int runSynthetic(unsigned int nr_commands, unsigned int commands_per_update, unsigned int seed)
+{
+  const unsigned int nr_maps = 4;
+  const double map_sizes[nr_maps] = { 3.0, 5.0, 5.0, 10.0 };      // [m]
+  const double resolutions[nr_maps] = { 0.05, 0.05, 0.02, 0.05 }; // [m]
+
+  CollisionFilterParameters parameters;
+  std::vector<geometry_msgs::Point> rectangle = createRectangle(0.35, -0.35, 0.3, -0.3);
+
+  // concave footprint of a base with an extended arm
+  std::vector<geometry_msgs::Point> concave = createRectangle(0.35, -0.35, 0.3, -0.3);
+  concave.insert(concave.begin() + 1, 3, geometry_msgs::Point());
+  concave[1].x = 0.1;
+  concave[1].y = 0.3;
+  concave[2].x = 0.1;
+  concave[2].y = 0.8;
+  concave[3].x = -0.05;
+  concave[3].y = 0.8;
+  concave[4].x = -0.05;
+  concave[4].y = 0.3;
+
+  unsigned int nr_mismatches = 0;
+  for (unsigned int m = 0; m < nr_maps; m++)
+  {
+    Costmap costmap;
+    costmap.size_x = costmap.size_y = (unsigned int)(map_sizes[m] / resolutions[m]);
+    costmap.resolution = resolutions[m];
+    costmap.origin_x = costmap.origin_y = -0.5 * map_sizes[m];
+    costmap.data.resize(costmap.size_x * costmap.size_y);
+
+    char name[128];
+    snprintf(name, sizeof(name), "map %.1f x %.1f m, resolution %.2f m (%u x %u cells)", map_sizes[m], map_sizes[m],
+             resolutions[m], costmap.size_x, costmap.size_y);
+
+    Runner runner(parameters, rectangle);
+    FootprintModelRunner rectangle_models(parameters, rectangle);
+    FootprintModelRunner concave_models(parameters, concave);
+    std::mt19937 generator(seed);
+    geometry_msgs::Twist twist;
+    for (unsigned int k = 0; k < nr_commands; k++)
+    {
+      if (k % commands_per_update == 0)
+        generateObstacles(generator, concave, costmap);
+      twist = nextCommand(generator, parameters, twist);
+      runner.step(costmap, twist);
+      rectangle_models.step(costmap, twist);
+      concave_models.step(costmap, twist);
+    }
+
+    printf("%s\n", name);
+    runner.print("rectangular footprint, core vs. reference");
+    rectangle_models.print("rectangular footprint, rectangle vs. polygon distance");
+    concave_models.print("concave footprint, rectangle vs. polygon distance");
+    nr_mismatches += runner.getNrMismatches();
+  }
+
+  return (nr_mismatches == 0) ? 0 : 1;
+}
+
+int replayBag(const std::string& filename, const std::string& costmap_topic, const std::string& command_topic)
+{
+#ifndef HAVE_ROSBAG
+  printf("bag replay is not available: built without rosbag\n");
+  return 2;
+#else
+  rosbag::Bag bag;
+  try
+  {
+    bag.open(filename, rosbag::bagmode::Read);
+  }
+  catch (rosbag::BagException& e)
+  {
+    ROS_ERROR_STREAM("Could not open bag file " << filename << ": " << e.what());
+    return 2;
+  }
+
+  std::vector<std::string> topics;
+  topics.push_back(costmap_topic);
+  topics.push_back(command_topic);
+  rosbag::View view(bag, rosbag::TopicQuery(topics));
+
+  CollisionFilterParameters parameters;
+  std::vector<geometry_msgs::Point> footprint = createRectangle(0.35, -0.35, 0.3, -0.3);
+  Runner runner(parameters, footprint);
+  FootprintModelRunner models(parameters, footprint);
+
+  Costmap costmap;
+  bool costmap_received = false;
+  for (rosbag::View::iterator it = view.begin(); it != view.end(); ++it)
+  {
+    nav_msgs::OccupancyGrid::ConstPtr grid = it->instantiate<nav_msgs::OccupancyGrid>();
+    if (grid)
+    {
+      fromOccupancyGrid(*grid, costmap);
+      costmap_received = true;
+      continue;
+    }
+
+    geometry_msgs::Twist::ConstPtr twist = it->instantiate<geometry_msgs::Twist>();
+    if (twist && costmap_received)
+    {
+      runner.step(costmap, *twist);
+      models.step(costmap, *twist);
+    }
+  }
+  bag.close();
+
+  printf("replay of %s\n", filename.c_str());
+  runner.print("core vs. reference");
+  models.print("rectangle vs. polygon distance");
+  return (runner.getNrMismatches() == 0) ? 0 : 1;
+#endif
+}
+
+}
+
+int main(int argc, char** argv)
+{
+  std::string bag_file;
+  std::string costmap_topic("/collision_velocity_filter/anti_collision_costmap/costmap");
+  std::string command_topic("/command_in");
+  unsigned int nr_commands = 5000, commands_per_update = 5, seed = 1;
+
+  for (int i = 1; i < argc; i++)
+  {
+    std::string arg(argv[i]);
+    if (arg == "--bag" && i + 1 < argc)
+      bag_file = argv[++i];
+    else if (arg == "--costmap_topic" && i + 1 < argc)
+      costmap_topic = argv[++i];
+    else if (arg == "--command_topic" && i + 1 < argc)
+      command_topic = argv[++i];
+    else if (arg == "--commands" && i + 1 < argc)
+      nr_commands = atoi(argv[++i]);
+    else if (arg == "--commands_per_update" && i + 1 < argc)
+      commands_per_update = std::max(1, atoi(argv[++i]));
+    else if (arg == "--seed" && i + 1 < argc)
+      seed = atoi(argv[++i]);
+    else
+    {
+      printf("usage: %s [--commands N] [--commands_per_update N] [--seed N]\n"
+             "       %s --bag FILE [--costmap_topic TOPIC] [--command_topic TOPIC]\n", argv[0], argv[0]);
+      return 2;
+    }
+  }
+
+  if (!bag_file.empty())
+    return replayBag(bag_file, costmap_topic, command_topic);
+  return runSynthetic(nr_commands, commands_per_update, seed);
+}
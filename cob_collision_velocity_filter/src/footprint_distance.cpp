@@ -0,0 +1,227 @@
+/*
+ * Copyright 2017 Fraunhofer Institute for Manufacturing Engineering and Automation (IPA)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <footprint_distance.h>
+
+#include <cmath>
+#include <limits>
+
+
+namespace cob_collision_velocity_filter
+{
+
+const double MIN_EDGE_LENGTH = 1e-9;
+
+
+FootprintDistance::FootprintDistance(unsigned int nr_buckets)
+{
+    nr_buckets_ = (nr_buckets > 0) ? nr_buckets : 1;
+    buckets_.resize(nr_buckets_);
+}
+
+FootprintDistance::~FootprintDistance()
+{
+}
+
+bool FootprintDistance::setPolygon(const std::vector<geometry_msgs::Point>& polygon)
+{
+    bool changed = (polygon.size() != polygon_.size());
+    for (unsigned int i = 0; !changed && i < polygon.size(); i++)
+    {
+        changed = (polygon[i].x != polygon_[i].x || polygon[i].y != polygon_[i].y);
+    }
+    if (!changed)
+        return false;
+
+    polygon_ = polygon;
+    edges_.clear();
+    for (unsigned int b = 0; b < nr_buckets_; b++)
+        buckets_[b].clear();
+
+    if (polygon_.size() < 3)
+        return true;
+
+    // orientation of the polygon, such that all normals point outwards
+    double area = 0.0;
+    for (unsigned int i = 0; i < polygon_.size(); i++)
+    {
+        const geometry_msgs::Point& a = polygon_[i];
+        const geometry_msgs::Point& b = polygon_[(i + 1) % polygon_.size()];
+        area += a.x * b.y - b.x * a.y;
+    }
+    double orientation = (area >= 0.0) ? 1.0 : -1.0;
+
+    for (unsigned int i = 0; i < polygon_.size(); i++)
+    {
+        const geometry_msgs::Point& a = polygon_[i];
+        const geometry_msgs::Point& b = polygon_[(i + 1) % polygon_.size()];
+
+        Edge edge;
+        edge.ax = a.x;
+        edge.ay = a.y;
+        edge.length = sqrt((b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y));
+        if (edge.length < MIN_EDGE_LENGTH)
+            continue;
+        edge.dx = (b.x - a.x) / edge.length;
+        edge.dy = (b.y - a.y) / edge.length;
+        edge.nx = orientation * edge.dy;
+        edge.ny = -orientation * edge.dx;
+        edge.cx = 0.5 * (a.x + b.x);
+        edge.cy = 0.5 * (a.y + b.y);
+        edge.radius = 0.5 * edge.length;
+
+        // an edge that does not contain the robot center covers the shorter arc between its vertices
+        unsigned int index = edges_.size();
+        edges_.push_back(edge);
+        double angle_a = atan2(a.y, a.x);
+        double angle_b = atan2(b.y, b.x);
+        double delta = angle_b - angle_a;
+        while (delta > M_PI)
+            delta -= 2.0 * M_PI;
+        while (delta <= -M_PI)
+            delta += 2.0 * M_PI;
+
+        if (fabs(delta) >= M_PI - MIN_EDGE_LENGTH)
+        {
+            for (unsigned int bucket = 0; bucket < nr_buckets_; bucket++)
+                buckets_[bucket].push_back(index);
+            continue;
+        }
+
+        unsigned int first = getBucket((delta >= 0.0) ? angle_a : angle_b);
+        unsigned int last = getBucket((delta >= 0.0) ? angle_b : angle_a);
+        for (unsigned int bucket = first; ; bucket = (bucket + 1) % nr_buckets_)
+        {
+            buckets_[bucket].push_back(index);
+            if (bucket == last)
+                break;
+        }
+    }
+
+    // the sum of the normals of both adjacent edges separates inside and outside at a shared vertex
+    for (unsigned int i = 0; i < edges_.size(); i++)
+    {
+        Edge& edge = edges_[i];
+        Edge& next = edges_[(i + 1) % edges_.size()];
+        edge.bnx = next.anx = edge.nx + next.nx;
+        edge.bny = next.any = edge.ny + next.ny;
+    }
+
+    return true;
+}
+
+bool FootprintDistance::isValid() const
+{
+    return edges_.size() >= 3;
+}
+
+bool FootprintDistance::isInside(double x, double y) const
+{
+    bool inside = false;
+    for (unsigned int i = 0, j = polygon_.size() - 1; i < polygon_.size(); j = i++)
+    {
+        const geometry_msgs::Point& a = polygon_[i];
+        const geometry_msgs::Point& b = polygon_[j];
+        if ((a.y > y) != (b.y > y)
+            && x < (b.x - a.x) * (y - a.y) / (b.y - a.y) + a.x)
+        {
+            inside = !inside;
+        }
+    }
+    return inside;
+}
+
+double FootprintDistance::getDistance(double x, double y) const
+{
+    if (edges_.empty())
+        return sqrt(x * x + y * y);
+
+    // upper bound from the edges in the direction of the point
+    double squared_distance = std::numeric_limits<double>::max();
+    bool outside = true;
+    const std::vector<unsigned int>& candidates = buckets_[getBucket(x, y)];
+    for (unsigned int i = 0; i < candidates.size(); i++)
+    {
+        bool edge_outside;
+        double edge_distance = getSquaredEdgeDistance(edges_[candidates[i]], x, y, edge_outside);
+        if (edge_distance < squared_distance)
+        {
+            squared_distance = edge_distance;
+            outside = edge_outside;
+        }
+    }
+    double distance = sqrt(squared_distance);
+
+    // remaining edges only if their bounding circle comes closer than the current distance
+    for (unsigned int i = 0; i < edges_.size(); i++)
+    {
+        const Edge& edge = edges_[i];
+        double center_distance = (x - edge.cx) * (x - edge.cx) + (y - edge.cy) * (y - edge.cy);
+        double bound = distance + edge.radius;
+        if (center_distance >= bound * bound)
+            continue;
+
+        bool edge_outside;
+        double edge_distance = getSquaredEdgeDistance(edge, x, y, edge_outside);
+        if (edge_distance < squared_distance)
+        {
+            squared_distance = edge_distance;
+            distance = sqrt(squared_distance);
+            outside = edge_outside;
+        }
+    }
+
+    return outside ? distance : -distance;
+}
+
+double FootprintDistance::getSquaredEdgeDistance(const Edge& edge, double x, double y, bool& outside) const
+{
+    double px = x - edge.ax;
+    double py = y - edge.ay;
+    double t = px * edge.dx + py * edge.dy;
+    if (t <= 0.0)
+    {
+        outside = (px * edge.anx + py * edge.any >= 0.0);
+        return px * px + py * py;
+    }
+    if (t >= edge.length)
+    {
+        double qx = px - edge.dx * edge.length;
+        double qy = py - edge.dy * edge.length;
+        outside = (qx * edge.bnx + qy * edge.bny >= 0.0);
+        return qx * qx + qy * qy;
+    }
+    double normal_distance = px * edge.nx + py * edge.ny;
+    outside = (normal_distance >= 0.0);
+    return normal_distance * normal_distance;
+}
+
+unsigned int FootprintDistance::getBucket(double x, double y) const
+{
+    return getBucket(atan2(y, x));
+}
+
+unsigned int FootprintDistance::getBucket(double angle) const
+{
+    int bucket = (int)floor((angle + M_PI) / (2.0 * M_PI) * nr_buckets_);
+    if (bucket < 0)
+        return 0;
+    if (bucket >= (int)nr_buckets_)
+        return nr_buckets_ - 1;
+    return bucket;
+}
+
+}
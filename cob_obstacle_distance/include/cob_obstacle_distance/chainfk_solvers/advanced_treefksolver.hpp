@@ -0,0 +1,80 @@
+/*
+ * Copyright 2017 Fraunhofer Institute for Manufacturing Engineering and Automation (IPA)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef ADVANCED_TREEFKSOLVER_H_
+#define ADVANCED_TREEFKSOLVER_H_
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <kdl/tree.hpp>
+#include <kdl/framevel.hpp>
+#include <kdl/jntarrayvel.hpp>
+
+/**
+ * Forward velocity kinematics of a whole tree (KDL::Tree) in a single pass.
+ * The segments are stored in topological order (parents before children), such that the frames of all segments
+ * relative to the tree root are computed by one sweep over contiguous arrays.
+ *
+ * @ingroup KinematicFamily
+ */
+class AdvancedTreeFkSolverVel
+{
+    public:
+        explicit AdvancedTreeFkSolverVel(const KDL::Tree& tree);
+
+        /**
+         * @param q_in Joint states of the whole tree (indexed by the q_nr of the tree segments).
+         * @return An error code (0 == success)
+         */
+        int JntToCart(const KDL::JntArrayVel& q_in);
+
+        /**
+         * @param segment_name Name of a segment (link) of the tree.
+         * @return Index of the segment or -1 if it is not part of the tree.
+         */
+        int getSegmentIndex(const std::string& segment_name) const;
+
+        /**
+         * @param seg_idx Index of the segment (see getSegmentIndex).
+         * @return The frame and its velocity of the segment relative to the tree root.
+         */
+        const KDL::FrameVel& getFrameVelAtSegment(uint32_t seg_idx) const;
+
+        inline uint32_t getNrOfSegments() const
+        {
+            return this->segments_.size();
+        }
+
+        inline uint32_t getNrOfJoints() const
+        {
+            return this->nr_of_joints_;
+        }
+
+    private:
+        std::vector<KDL::Segment> segments_;
+        std::vector<int32_t> parents_;  ///< index of the parent segment, -1 for the tree root
+        std::vector<int32_t> q_nrs_;  ///< index into the joint arrays, -1 for fixed joints
+        std::vector<KDL::FrameVel> local_frames_;  ///< frame relative to the parent (constant for fixed joints)
+        std::vector<KDL::FrameVel> frames_;  ///< frame relative to the tree root, result of the last JntToCart
+        std::unordered_map<std::string, uint32_t> indices_;
+        uint32_t nr_of_joints_;
+};
+
+#endif /* ADVANCED_TREEFKSOLVER_H_ */
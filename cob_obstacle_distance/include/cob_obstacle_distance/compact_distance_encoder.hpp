@@ -0,0 +1,80 @@
+/*
+ * Copyright 2017 Fraunhofer Institute for Manufacturing Engineering and Automation (IPA)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef COMPACT_DISTANCE_ENCODER_HPP_
+#define COMPACT_DISTANCE_ENCODER_HPP_
+
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "cob_control_msgs/ObstacleDistance.h"
+#include "cob_control_msgs/CompactObstacleDistances.h"
+#include "cob_control_msgs/ObstacleDistanceNames.h"
+
+/// Encodes the obstacle distances of a cycle as indices into a name table and only keeps the pairs that changed
+/// with respect to what has been sent before. Every keyframe_interval cycles all current pairs are sent again.
+class CompactDistanceEncoder
+{
+    public:
+        /**
+         * @param change_tolerance Change in [m] of the distance or of a vector (in [s] of the time to contact) below which a pair is not sent again.
+         * @param keyframe_interval Number of cycles between two keyframes (1 sends all pairs in every cycle).
+         */
+        CompactDistanceEncoder(double change_tolerance, uint32_t keyframe_interval);
+
+        /**
+         * Encodes the distances of one cycle relative to the previously encoded ones.
+         * @param distances All distances of the cycle.
+         * @param msg The compact message (header is not touched).
+         * @return True if the message has to be published, i.e. it is a keyframe or contains changes.
+         */
+        bool encode(const std::vector<cob_control_msgs::ObstacleDistance>& distances,
+                    cob_control_msgs::CompactObstacleDistances& msg);
+
+        /**
+         * @param names The name table (header is not touched).
+         * @return True if the name table changed since the last call, i.e. it has to be published.
+         */
+        bool getChangedNames(cob_control_msgs::ObstacleDistanceNames& names);
+
+    private:
+        double change_tolerance_;
+        uint32_t keyframe_interval_;
+        uint32_t cycles_since_keyframe_;
+        uint32_t sequence_;
+
+        cob_control_msgs::ObstacleDistanceNames names_;
+        bool names_changed_;
+        std::unordered_map<std::string, uint16_t> link_indices_;
+        std::unordered_map<std::string, uint16_t> obstacle_indices_;
+
+        /// first: link index << 16 | obstacle index, second: the pair as it is known to the subscribers
+        std::unordered_map<uint32_t, cob_control_msgs::CompactObstacleDistance> sent_;
+
+        uint16_t getIndex(const std::string& name,
+                          std::unordered_map<std::string, uint16_t>& indices,
+                          std::vector<std::string>& table);
+
+        bool hasChanged(const cob_control_msgs::CompactObstacleDistance& sent,
+                        const cob_control_msgs::CompactObstacleDistance& current) const;
+
+        void resetNames();
+};
+
+#endif /* COMPACT_DISTANCE_ENCODER_HPP_ */
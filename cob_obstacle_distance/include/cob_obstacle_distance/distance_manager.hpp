@@ -18,9 +18,13 @@
 #ifndef DISTANCE_MANAGER_HPP_
 #define DISTANCE_MANAGER_HPP_
 
+#include <map>
+#include <string>
+#include <unordered_map>
 #include <vector>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #include <boost/scoped_ptr.hpp>
 #include <cob_obstacle_distance/link_to_collision.hpp>
 
@@ -29,70 +33,269 @@
 #include <kdl_parser/kdl_parser.hpp>
 #include <kdl/tree.hpp>
 #include <kdl/frames.hpp>
+#include <kdl/jntarray.hpp>
 
 #include <Eigen/Dense>
 
+#include <fcl/collision_object.h>
+
 #include <tf/tf.h>
 #include <tf/transform_listener.h>
 #include <tf_conversions/tf_kdl.h>
 #include <tf_conversions/tf_eigen.h>
 
 #include <sensor_msgs/JointState.h>
+#include <sensor_msgs/PointCloud2.h>
 #include <moveit_msgs/CollisionObject.h>
+#include <moveit_msgs/PlanningScene.h>
 #include "cob_srvs/SetString.h"
+#include "cob_control_msgs/ObstacleDistance.h"
 
 #include "cob_obstacle_distance/marker_shapes/marker_shapes.hpp"
 #include "cob_obstacle_distance/shapes_manager.hpp"
-#include "cob_obstacle_distance/chainfk_solvers/advanced_chainfksolver_recursive.hpp"
+#include "cob_obstacle_distance/static_distance_field.hpp"
+#include "cob_obstacle_distance/point_cloud_obstacles.hpp"
+#include "cob_obstacle_distance/compact_distance_encoder.hpp"
+#include "cob_obstacle_distance/chainfk_solvers/advanced_treefksolver.hpp"
 #include "cob_obstacle_distance/obstacle_distance_data_types.hpp"
 
 
 class DistanceManager
 {
     private:
+        /// Result of the last narrow-phase query of a link / obstacle pair. Used for temporal coherence between cycles.
+        struct PairCacheEntry
+        {
+            PairCacheEntry() : obstacle_(NULL), distance_(0.0), exact_(false) {}
+
+            const fcl::CollisionObject* obstacle_;
+            fcl::Transform3f link_transform_;
+            fcl::Transform3f obstacle_transform_;
+            fcl::FCL_REAL distance_;
+            bool exact_;  ///< false if distance_ is only the lower bound of the coarse proxy stage
+            fcl::Vec3f nearest_points_[2];
+        };
+
+        /// first: link of interest, second: cache entries per obstacle id
+        typedef std::unordered_map<std::string, std::unordered_map<std::string, PairCacheEntry> > PairCache_t;
+
+        /// first: frame id of a message header, second: its transformation to the root frame (looked up once per batch)
+        typedef std::map<std::string, tf::StampedTransform> FrameTransforms_t;
+
+        /// A link of interest to be processed by one of the workers within a calculation cycle.
+        struct WorkItem
+        {
+            std::string name_;
+            PtrIMarkerShape_t ooi_;
+            uint32_t segment_idx_;  ///< index of the link in the tree FK solver
+            std::unordered_map<std::string, PairCacheEntry>* pair_cache_;
+        };
+
+        /// Distances and statistics of one link of interest. Merged in link order after all workers finished.
+        struct WorkResult
+        {
+            WorkResult() : num_pairs_(0), num_queries_(0), num_reused_(0), num_skipped_(0), num_coarse_(0), num_field_(0), num_cloud_points_(0) {}
+
+            std::vector<cob_control_msgs::ObstacleDistance> distances_;
+            uint32_t num_pairs_;
+            uint32_t num_queries_;
+            uint32_t num_reused_;
+            uint32_t num_skipped_;
+            uint32_t num_coarse_;
+            uint32_t num_field_;
+            uint32_t num_cloud_points_;
+        };
+
         std::string root_frame_id_;
         std::string chain_base_link_;
-        std::string chain_tip_link_;
 
         boost::scoped_ptr<ShapesManager> obstacle_mgr_;
         boost::scoped_ptr<ShapesManager> object_of_interest_mgr_;
 
-        std::vector<std::thread> self_collision_transform_threads_;
         std::mutex mtx_;
         std::mutex obstacle_mgr_mtx_;
+        std::mutex object_of_interest_mgr_mtx_;
+        std::mutex joint_state_mtx_;
         bool stop_sca_threads_;
 
-        boost::scoped_ptr<AdvancedChainFkSolverVel_recursive> adv_chn_fk_solver_vel_;
-        KDL::Chain chain_;
+        std::vector<std::thread> workers_;  ///< worker pool; the calling thread of calculate() acts as worker 0
+        uint16_t num_workers_;
+        std::mutex work_mtx_;
+        std::condition_variable work_cv_;
+        std::condition_variable done_cv_;
+        uint32_t work_cycle_;
+        uint16_t pending_workers_;
+        bool stop_workers_;
+        std::vector<WorkItem> work_items_;
+        std::vector<WorkResult> work_results_;
+        Eigen::Affine3d work_tf_cb_frame_bl_;  ///< chain base to root frame transform, sampled once per cycle
+        KDL::FrameVel work_cb_tree_root_;  ///< tree root relative to the chain base, computed once per cycle
+
+        KDL::Tree tree_;
+        boost::scoped_ptr<AdvancedTreeFkSolverVel> tree_fk_solver_;  ///< frames of all links of the robot from the joint states
+        int chain_base_idx_;  ///< index of chain_base_link in the tree FK solver
+        int root_frame_idx_;  ///< index of the root frame in the tree FK solver, -1 if it is not a link of the robot (then tf is used)
+        std::unordered_map<std::string, unsigned int> tree_joint_idx_;  ///< joint name -> index in tree_q_
+        KDL::JntArray tree_q_;  ///< last known positions of all tree joints (updated from joint_states)
+        KDL::JntArray tree_q_dot_;  ///< last known velocities of all tree joints (updated from joint_states)
+        KDL::JntArrayVel tree_q_cycle_;  ///< copy of tree_q_ and tree_q_dot_ used within one calculation cycle
+        std::vector<std::string> self_collision_links_;
+        std::vector<uint32_t> self_collision_idx_;  ///< indices of self_collision_links_ in the tree FK solver
 
         ros::NodeHandle& nh_;
         ros::Publisher marker_pub_;
         ros::Publisher obstacle_distances_pub_;
+        ros::Publisher compact_distances_pub_;
+        ros::Publisher distance_names_pub_;
         tf::TransformListener tf_listener_;
         Eigen::Affine3d tf_cb_frame_bl_;
 
-        std::vector<std::string> joints_;
-        std::vector<std::string> segments_;
-        KDL::JntArray last_q_;
-        KDL::JntArray last_q_dot_;
 
         LinkToCollision link_to_collision_;
 
+        PairCache_t pair_cache_;  ///< guarded by obstacle_mgr_mtx_
+        double cache_tolerance_;  ///< motion [m] below which a cached pair result is reused without a new query
+        double lod_activation_distance_;  ///< pairs whose coarse proxy distance is above are not refined with the full geometry
+        boost::scoped_ptr<StaticDistanceField> static_field_;  ///< distance field of the registered obstacles (NULL if disabled)
+        boost::scoped_ptr<PointCloudObstacles> point_cloud_obstacles_;  ///< occupied voxels from point clouds (NULL if disabled)
+        std::shared_ptr<const PointCloudObstacles::Snapshot> cloud_snapshot_;  ///< point cloud state of the current cycle
+        ros::Time cloud_time_;  ///< time of the current cycle for the decay of the point cloud voxels
+        boost::scoped_ptr<CompactDistanceEncoder> compact_encoder_;  ///< delta encoder of the compact output (NULL if disabled)
+        uint32_t closest_obstacles_per_link_;  ///< only the k closest obstacles per link are published (0: all)
+        double continuous_horizon_;  ///< [s] horizon of the time to contact (<= 0: continuous mode disabled)
+
         static uint32_t seq_nr_;
 
         /**
-         * Build an obstacle from a message containing a mesh.
+         * Waits for the transformation from a frame to the root frame and adds it to the given map.
+         * Must be called without holding obstacle_mgr_mtx_, since it may block up to 0.5 s.
+         * @param frame_id The frame to be transformed into the root frame.
+         * @param frame_transforms Map the transformation is added to.
+         * @return True if the transformation has been found.
+         */
+        bool lookupFrameTransform(const std::string& frame_id, FrameTransforms_t& frame_transforms);
+
+        /**
+         * Applies the operation of a collision object message to the obstacles. The caller has to hold obstacle_mgr_mtx_.
+         * Does not draw the obstacles, such that a whole batch of messages is drawn only once.
+         * @param msg Msg struct of the collision object.
+         * @param frame_transforms Transformations to the root frame, looked up before locking.
+         * @return True if the obstacle has been changed.
+         */
+        bool applyCollisionObject(const moveit_msgs::CollisionObject& msg, const FrameTransforms_t& frame_transforms);
+
+        /**
+         * Build an obstacle from a message containing a single mesh.
          * @param msg Msg struct that contains mesh info.
          * @param transform The transformation from a frame in msg header to root_frame_id.
+         * @return True if the obstacle has been added.
          */
-        void buildObstacleMesh(const moveit_msgs::CollisionObject::ConstPtr& msg, const tf::StampedTransform& transform);
+        bool buildObstacleMesh(const moveit_msgs::CollisionObject& msg, const tf::StampedTransform& transform);
 
         /**
-         * Build an obstacle from a message containing a primitive shape.
-         * @param msg Msg struct that contains mesh info.
+         * Build an obstacle from a message containing a single primitive shape.
+         * @param msg Msg struct that contains primitive info.
+         * @param transform The transformation from a frame in msg header to root_frame_id.
+         * @return True if the obstacle has been added.
+         */
+        bool buildObstaclePrimitive(const moveit_msgs::CollisionObject& msg, const tf::StampedTransform& transform);
+
+        /**
+         * Build one compound obstacle from all primitives and meshes of a message.
+         * The parts are merged into a single mesh in the frame of the first part (first primitive, else first mesh).
+         * @param msg Msg struct that contains primitive and mesh info.
          * @param transform The transformation from a frame in msg header to root_frame_id.
+         * @return True if the obstacle has been added.
+         */
+        bool buildObstacleCompound(const moveit_msgs::CollisionObject& msg, const tf::StampedTransform& transform);
+
+        /**
+         * Removes an obstacle from the shapes manager, the pair cache and the distance field.
+         * @param obstacle_id The id of the obstacle.
+         */
+        void removeObstacle(const std::string& obstacle_id);
+
+        /**
+         * Time to contact of a link that keeps its current velocity with a (static) obstacle by conservative advancement.
+         * Each step advances the link by the time in which no point of it can travel farther than the current distance.
+         * @param ooi_co The collision object of the link at its current pose.
+         * @param twist The velocity of the link at the origin of its collision object (root frame).
+         * @param obstacle The collision object of the obstacle.
+         * @param distance The current distance between link and obstacle.
+         * @return A lower bound of the time to contact in [s] or -1.0 if there is no contact within the horizon
+         *         or the advancement does not converge within CONTINUOUS_MAX_ITERATIONS steps.
+         */
+        double timeToContact(const fcl::CollisionObject& ooi_co,
+                             const KDL::Twist& twist,
+                             const fcl::CollisionObject& obstacle,
+                             double distance) const;
+
+        /**
+         * Drops the cached pair results of an obstacle that is no longer managed. The caller has to hold obstacle_mgr_mtx_.
+         * @param obstacle_id The id of the removed obstacle.
          */
-        void buildObstaclePrimitive(const moveit_msgs::CollisionObject::ConstPtr& msg, const tf::StampedTransform& transform);
+        void removeFromPairCache(const std::string& obstacle_id);
+
+        /**
+         * Distance between a link and a static obstacle by lookups in the obstacle's distance field at the spheres of the link proxy.
+         * Keeps the closest sphere. The caller has to hold obstacle_mgr_mtx_.
+         * @param item The link of interest.
+         * @param obstacle_id The id of the static obstacle.
+         * @param ooi_co The collision object of the link at its current pose.
+         * @param chainbase2frame_pos The position of the link frame (chain base frame).
+         * @param result The distances to be published and the query statistics.
+         * @return False if the field cannot bound the distance (no proxy or spheres beyond the grid), then the narrow phase has to.
+         */
+        bool calculateStaticField(const WorkItem& item,
+                                  const std::string& obstacle_id,
+                                  const fcl::CollisionObject& ooi_co,
+                                  const Eigen::Vector3d& chainbase2frame_pos,
+                                  WorkResult& result);
+
+        /**
+         * Distance between a link and the closest occupied voxel of the point clouds.
+         * Candidates are ranked by the link proxy (or its bounding sphere), the best ones are refined by an exact query.
+         * @param item The link of interest.
+         * @param ooi_co The collision object of the link at its current pose.
+         * @param chainbase2frame_pos The position of the link frame (chain base frame).
+         * @param result The distances to be published and the query statistics.
+         */
+        void calculatePointCloud(const WorkItem& item,
+                                 const fcl::CollisionObject& ooi_co,
+                                 const Eigen::Vector3d& chainbase2frame_pos,
+                                 WorkResult& result);
+
+        /**
+         * Updates the poses of all self-collision obstacles from the tree FK of this cycle.
+         * The caller has to hold obstacle_mgr_mtx_.
+         * @param tf_cb_frame_bl The transformation from root frame to chain base link of this cycle.
+         */
+        void updateSelfCollisionPoses(const Eigen::Affine3d& tf_cb_frame_bl);
+
+        /**
+         * Loop of a pool worker. Waits for a new calculation cycle and processes its share of the links of interest.
+         * @param worker_idx The index of the worker (1 .. num_workers_ - 1).
+         */
+        void calculateWorker(uint16_t worker_idx);
+
+        /**
+         * Processes every num_workers_-th work item of the current cycle starting at worker_idx.
+         * @param worker_idx The index of the worker.
+         */
+        void processWorkItems(uint16_t worker_idx);
+
+        /**
+         * Calculates the distances between one link of interest and all obstacles.
+         * The caller has to hold obstacle_mgr_mtx_ and object_of_interest_mgr_mtx_.
+         * @param item The link of interest.
+         * @param result The distances to be published and the query statistics.
+         */
+        void calculateLink(const WorkItem& item, WorkResult& result);
+
+        /**
+         * Stops and joins the worker pool.
+         */
+        void stopWorkers();
 
     public:
         /**
@@ -140,12 +343,26 @@ class DistanceManager
          */
         void jointstateCb(const sensor_msgs::JointState::ConstPtr& msg);
 
+        /**
+         * Inserts a point cloud into the occupied voxels (only if point cloud obstacles are enabled).
+         * The cloud should not contain the robot itself (e.g. filtered by a robot self filter).
+         * @param msg Point cloud message.
+         */
+        void pointcloudCb(const sensor_msgs::PointCloud2::ConstPtr& msg);
+
         /**
          * Registers an obstacle via message.
          * @param msg MoveIt CollisionObject message type.
          */
         void registerObstacle(const moveit_msgs::CollisionObject::ConstPtr& msg);
 
+        /**
+         * Registers all collision objects of a planning scene at once and draws the obstacles only once.
+         * A complete scene (no diff) replaces all obstacles that have been registered before.
+         * @param msg MoveIt PlanningScene message type (only the collision objects of the world are used).
+         */
+        void registerPlanningScene(const moveit_msgs::PlanningScene::ConstPtr& msg);
+
         /**
          * Initialization of ROS robot structure, parameters, publishers and subscribers.
          * @return Error status. If 0 then success.
@@ -154,19 +371,13 @@ class DistanceManager
 
         /**
          * tf Transformation thread between chain_base_link (arm_right_base_link or arm_left_base_link) and the root frame (e.g. base_link)).
-         * Runs endless.
+         * Runs endless. Returns immediately if the root frame is a link of the robot, then the transformation is computed by tree FK.
          */
         void transform();
 
-        /**
-         * Thread that runs endless to listen to transforms for the self collision parts of the robot.
-         * This will directly update the self collision obstacle pose.
-         * @param link_name The link name of the self collision checking part. Similar to link name in URDF.
-         */
-        void transformSelfCollisionLinks(const std::string link_name);
-
         /**
          * Calculate the distances between the objects of interest (reference frames at KDL::segments) and obstacles.
+         * The links of interest are partitioned across the worker pool and the results are merged into one message.
          * Publishes them on the obstacle_distance topic according to robot_namespace (arm_right, arm_left, ...)
          */
         void calculate();
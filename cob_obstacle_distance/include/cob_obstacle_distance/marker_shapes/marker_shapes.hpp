@@ -91,11 +91,6 @@ class MarkerShape : public IMarkerShape
 
         inline void updatePose(const geometry_msgs::Pose& pose);
 
-        /**
-         * @return A fcl::CollisionObject to calculate distances to other objects or check whether collision occurred or not.
-         */
-        fcl::CollisionObject getCollisionObject() const;
-
         virtual ~MarkerShape(){}
 };
 /* END MarkerShape **********************************************************************************************/
@@ -154,11 +149,6 @@ class MarkerShape<BVH_RSS_t> : public IMarkerShape
 
         inline void updatePose(const geometry_msgs::Pose& pose);
 
-        /**
-         * @return A fcl::CollisionObject to calculate distances to other objects or check whether collision occurred or not.
-         */
-        fcl::CollisionObject getCollisionObject() const;
-
         virtual ~MarkerShape(){}
 };
 /* END MarkerShape **********************************************************************************************/
@@ -81,10 +81,11 @@ void MarkerShape<T>::init(const std::string& root_frame, double x, double y, dou
 
     fcl_marker_converter_.assignValues(marker_);
 
-    BVH_RSS_t bvh;
-    fcl_marker_converter_.getBvhModel(bvh);
-    this->ptr_fcl_bvh_.reset(new BVH_RSS_t(bvh));
+    this->ptr_fcl_bvh_.reset(new BVH_RSS_t());
+    fcl_marker_converter_.getBvhModel(*this->ptr_fcl_bvh_);
     this->ptr_fcl_bvh_->computeLocalAABB();
+    this->proxy_ = SphereProxy::create(*this->ptr_fcl_bvh_);
+    this->initCollisionObject(this->ptr_fcl_bvh_);
 }
 
 
@@ -114,35 +115,22 @@ inline visualization_msgs::Marker MarkerShape<T>::getMarker()
 }
 
 
-template <typename T>
-fcl::CollisionObject MarkerShape<T>::getCollisionObject() const
-{
-    fcl::Transform3f x(fcl::Quaternion3f(this->marker_.pose.orientation.w,
-                                         this->marker_.pose.orientation.x,
-                                         this->marker_.pose.orientation.y,
-                                         this->marker_.pose.orientation.z),
-                       fcl::Vec3f(this->marker_.pose.position.x,
-                                  this->marker_.pose.position.y,
-                                  this->marker_.pose.position.z));
-    fcl::CollisionObject cobj(this->ptr_fcl_bvh_, x);
-    return cobj;
-}
-
-
 template <typename T>
 inline void MarkerShape<T>::updatePose(const geometry_msgs::Vector3& pos, const geometry_msgs::Quaternion& quat)
 {
-    marker_.pose.position.x = pos.x;
-    marker_.pose.position.y = pos.y;
-    marker_.pose.position.z = pos.z;
-    marker_.pose.orientation = quat;
+    geometry_msgs::Pose pose;
+    pose.position.x = pos.x;
+    pose.position.y = pos.y;
+    pose.position.z = pos.z;
+    pose.orientation = quat;
+    this->setPose(pose);
 }
 
 
 template <typename T>
 inline void MarkerShape<T>::updatePose(const geometry_msgs::Pose& pose)
 {
-    marker_.pose = pose;
+    this->setPose(pose);
 }
 
 /* END MarkerShape **********************************************************************************************/
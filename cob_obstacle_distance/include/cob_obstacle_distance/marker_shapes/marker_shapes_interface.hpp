@@ -19,11 +19,15 @@
 #define MARKER_SHAPES_INTERFACE_HPP_
 
 #include <boost/shared_ptr.hpp>
+#include <memory>
 #include <stdint.h>
+#include <geometry_msgs/Pose.h>
 #include <visualization_msgs/Marker.h>
 #include <fcl/collision_object.h>
 #include <fcl/BVH/BVH_model.h>
 
+#include "cob_obstacle_distance/marker_shapes/sphere_proxy.hpp"
+
 /* BEGIN IMarkerShape *******************************************************************************************/
 /// Interface class marking methods that have to be implemented in derived classes.
 class IMarkerShape
@@ -33,6 +37,22 @@ class IMarkerShape
         visualization_msgs::Marker marker_;
         geometry_msgs::Pose origin_;
         bool drawable_; ///> If the marker shape is even drawable or not.
+        std::shared_ptr<fcl::CollisionObject> collision_object_; ///> Persistent collision object. Its transform follows the marker pose.
+        bool moved_; ///> If the pose of the collision object changed since the last call of resetMoved().
+        PtrConstSphereProxy_t proxy_; ///> Coarse level of detail of the collision geometry (empty if disabled).
+
+        /**
+         * Creates the persistent collision object for the given geometry at the current marker pose.
+         * @param geometry The fcl geometry (e.g. a BVH model) in the local frame of the shape.
+         */
+        void initCollisionObject(const std::shared_ptr<fcl::CollisionGeometry>& geometry);
+
+        /**
+         * Sets the marker pose and updates the transform of the collision object in place.
+         * The AABB in root frame is only recomputed if the pose changed.
+         * @param pose The new pose of the shape (with respect to the root frame).
+         */
+        void setPose(const geometry_msgs::Pose& pose);
 
     public:
          IMarkerShape();
@@ -41,7 +61,6 @@ class IMarkerShape
          virtual visualization_msgs::Marker getMarker() = 0;
          virtual void updatePose(const geometry_msgs::Vector3& pos, const geometry_msgs::Quaternion& quat) = 0;
          virtual void updatePose(const geometry_msgs::Pose& pose) = 0;
-         virtual fcl::CollisionObject getCollisionObject() const = 0;
          virtual geometry_msgs::Pose getMarkerPose() const = 0;
          virtual geometry_msgs::Pose getOriginRelToFrame() const = 0;
 
@@ -61,6 +80,35 @@ class IMarkerShape
              return this->drawable_;
          }
 
+         /**
+          * @return The persistent fcl::CollisionObject to calculate distances to other objects or check whether collision occurred or not.
+          */
+         inline fcl::CollisionObject& getCollisionObject()
+         {
+             return *this->collision_object_;
+         }
+
+         /**
+          * @return The coarse sphere proxy of the collision geometry or NULL if there is none.
+          */
+         inline const SphereProxy* getProxy() const
+         {
+             return this->proxy_.get();
+         }
+
+         /**
+          * @return If the pose of the collision object changed since the last call of resetMoved().
+          */
+         inline bool hasMoved() const
+         {
+             return this->moved_;
+         }
+
+         inline void resetMoved()
+         {
+             this->moved_ = false;
+         }
+
          virtual ~IMarkerShape() {}
 };
 /* END IMarkerShape *********************************************************************************************/
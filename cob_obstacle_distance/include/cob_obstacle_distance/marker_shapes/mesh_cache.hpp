@@ -0,0 +1,98 @@
+/*
+ * Copyright 2017 Fraunhofer Institute for Manufacturing Engineering and Automation (IPA)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef MESH_CACHE_HPP_
+#define MESH_CACHE_HPP_
+
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <shape_msgs/Mesh.h>
+
+#include "cob_obstacle_distance/marker_shapes/marker_shapes_interface.hpp"
+
+/// Process-wide cache of BVH models. Shapes created from the same mesh share one BVH model instead of parsing and building it again.
+/// The shared models and their sphere proxies must be treated as immutable. Models are released as soon as the last shape using them is destroyed, their entries are pruned on the next cache miss.
+class MeshCache
+{
+    private:
+        struct FileEntry
+        {
+            std::time_t mtime_;
+            std::weak_ptr<BVH_RSS_t> bvh_;
+            std::weak_ptr<const SphereProxy> proxy_;
+        };
+
+        struct MeshEntry
+        {
+            shape_msgs::Mesh mesh_;  ///< copy of the content, hash collisions must not share a model
+            std::weak_ptr<BVH_RSS_t> bvh_;
+            std::weak_ptr<const SphereProxy> proxy_;
+        };
+
+        std::mutex mtx_;
+        bool deduplicate_vertices_;  ///< passed to the parsers of mesh files
+        std::unordered_map<std::string, FileEntry> file_entries_;  ///< key: resolved file path
+        std::unordered_map<std::string, MeshEntry> mesh_entries_;  ///< key: content hash of a shape_msgs::Mesh
+
+        MeshCache() : deduplicate_vertices_(false) {}
+        MeshCache(const MeshCache&);
+        MeshCache& operator=(const MeshCache&);
+
+        /**
+         * Builds the cache key of a mesh message from its sizes and a hash over its vertices and triangles.
+         * @param mesh The mesh message.
+         * @return The content key.
+         */
+        static std::string contentKey(const shape_msgs::Mesh& mesh);
+
+        /**
+         * Compares the vertices and triangles of two mesh messages.
+         * @return True if both meshes have identical content.
+         */
+        static bool sameContent(const shape_msgs::Mesh& a, const shape_msgs::Mesh& b);
+
+    public:
+        static MeshCache& getInstance();
+
+        /**
+         * Sets whether identical vertices of mesh files parsed from now on shall share one index in the vertex buffer.
+         */
+        void setDeduplicateVertices(bool deduplicate_vertices);
+
+        /**
+         * Returns the BVH model of a mesh file. The file is only parsed if it is not cached or has been modified since.
+         * STL files are read by the StlParser, all other formats (and STL files it fails on) by Assimp.
+         * @param mesh_resource Can be an URI name (e.g. package:// ...) or a full path.
+         * @param proxy The shared sphere proxy of the model (empty if proxies are disabled).
+         * @return The shared BVH model or an empty pointer if the mesh could not be read.
+         */
+        std::shared_ptr<BVH_RSS_t> getBvh(const std::string& mesh_resource, PtrConstSphereProxy_t& proxy);
+
+        /**
+         * Returns the BVH model of a mesh given by message. Meshes with identical content share one BVH model.
+         * @param mesh The mesh message.
+         * @param proxy The shared sphere proxy of the model (empty if proxies are disabled).
+         * @return The shared BVH model.
+         */
+        std::shared_ptr<BVH_RSS_t> getBvh(const shape_msgs::Mesh& mesh, PtrConstSphereProxy_t& proxy);
+};
+
+#endif /* MESH_CACHE_HPP_ */
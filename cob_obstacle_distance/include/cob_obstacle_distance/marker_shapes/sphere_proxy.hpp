@@ -0,0 +1,130 @@
+/*
+ * Copyright 2017 Fraunhofer Institute for Manufacturing Engineering and Automation (IPA)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef SPHERE_PROXY_HPP_
+#define SPHERE_PROXY_HPP_
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include <fcl/math/transform.h>
+#include <fcl/BV/AABB.h>
+#include <fcl/BVH/BVH_model.h>
+
+/// Coarse level of detail of a BVH model: a set of spheres that together enclose all triangles.
+/// The distance between two proxies is a lower bound for the distance between the enclosed geometries.
+class SphereProxy
+{
+    public:
+        struct Sphere
+        {
+            fcl::Vec3f center_;
+            double radius_;
+        };
+
+        /**
+         * Builds the sphere set by recursively splitting the triangles at the median of the longest axis,
+         * until every sphere radius is below the error bound or the maximal number of spheres is reached.
+         * In the latter case the error bound is not met, getAchievedError() reports the actual one.
+         * @param bvh The BVH model to enclose (in its local frame).
+         * @param error_bound Target radius of the spheres in [m].
+         * @param max_spheres Maximal number of spheres.
+         */
+        template <typename BV>
+        SphereProxy(const fcl::BVHModel<BV>& bvh, double error_bound, uint32_t max_spheres);
+
+        inline const std::vector<Sphere>& getSpheres() const
+        {
+            return this->spheres_;
+        }
+
+        /**
+         * @return The radius of the largest sphere in [m], i.e. the error bound the proxy actually achieves.
+         */
+        inline double getAchievedError() const
+        {
+            return this->achieved_error_;
+        }
+
+        /**
+         * Lower bound for the distance between the geometries enclosed by two proxies.
+         * @param tf The transform of this proxy.
+         * @param other The other proxy.
+         * @param other_tf The transform of the other proxy.
+         * @param stop_below The evaluation stops as soon as the bound falls below this value.
+         * @return The lower bound in [m] (negative for overlapping spheres).
+         */
+        double distance(const fcl::Transform3f& tf, const SphereProxy& other, const fcl::Transform3f& other_tf, double stop_below) const;
+
+        /**
+         * Creates the proxy of a BVH model with the current level of detail.
+         * @param bvh The BVH model to enclose.
+         * @return The proxy or an empty pointer if proxies are disabled.
+         */
+        template <typename BV>
+        static std::shared_ptr<const SphereProxy> create(const fcl::BVHModel<BV>& bvh);
+
+        /**
+         * Sets the level of detail for proxies created from now on. An error bound <= 0 disables the proxies.
+         */
+        static void setLevelOfDetail(double error_bound, uint32_t max_spheres);
+
+        static double getErrorBound();
+
+        static uint32_t getMaxSpheres();
+
+    private:
+        std::vector<Sphere> spheres_;
+        double achieved_error_;
+
+        static double error_bound_;
+        static uint32_t max_spheres_;
+
+        /**
+         * Builds the enclosing spheres from a triangle soup.
+         * @param vertices The vertex buffer.
+         * @param triangles The index buffer (three vertex indices per triangle).
+         */
+        void build(const std::vector<fcl::Vec3f>& vertices, const std::vector<fcl::Triangle>& triangles, double error_bound, uint32_t max_spheres);
+};
+
+typedef std::shared_ptr<const SphereProxy> PtrConstSphereProxy_t;
+
+
+template <typename BV>
+SphereProxy::SphereProxy(const fcl::BVHModel<BV>& bvh, double error_bound, uint32_t max_spheres)
+: achieved_error_(0.0)
+{
+    std::vector<fcl::Vec3f> vertices(bvh.vertices, bvh.vertices + bvh.num_vertices);
+    std::vector<fcl::Triangle> triangles(bvh.tri_indices, bvh.tri_indices + bvh.num_tris);
+    this->build(vertices, triangles, error_bound, max_spheres);
+}
+
+
+template <typename BV>
+std::shared_ptr<const SphereProxy> SphereProxy::create(const fcl::BVHModel<BV>& bvh)
+{
+    if (error_bound_ <= 0.0 || bvh.num_tris <= 0)
+    {
+        return std::shared_ptr<const SphereProxy>();
+    }
+
+    return std::make_shared<const SphereProxy>(bvh, error_bound_, max_spheres_);
+}
+
+#endif /* SPHERE_PROXY_HPP_ */
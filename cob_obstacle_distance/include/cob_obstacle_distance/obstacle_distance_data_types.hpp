@@ -33,6 +33,27 @@
 
 #define MIN_DISTANCE 0.5 // [m]: filter for distances to be published!
 
+#define DEFAULT_CACHE_TOLERANCE 0.001 // [m]: motion of a link / obstacle pair below which the last distance result is reused
+
+#define DEFAULT_LOD_ERROR_BOUND 0.02 // [m]: target radius of the sphere proxies used for the coarse distance stage (<= 0 disables it)
+#define DEFAULT_LOD_MAX_SPHERES 64 // maximal number of spheres of one proxy
+
+#define DEFAULT_SDF_RESOLUTION 0.025 // [m]: voxel size of the signed distance field of static obstacles
+
+#define DEFAULT_POINT_CLOUD_VOXEL_SIZE 0.05 // [m]: voxel size for the downsampling of point clouds
+#define DEFAULT_POINT_CLOUD_DECAY_TIME 1.0 // [s]: voxels not observed again within this time are dropped
+#define POINT_CLOUD_REFINE_CANDIDATES 4 // number of closest voxels per link refined by an exact distance query
+#define POINT_CLOUD_OBSTACLE_ID "point_cloud"
+
+#define CONTINUOUS_CONTACT_DISTANCE 0.001 // [m]: distance at which the conservative advancement reports a contact
+#define CONTINUOUS_MAX_ITERATIONS 10 // maximal number of conservative advancement steps per pair
+
+#define DEFAULT_COMPACT_CHANGE_TOLERANCE 0.001 // [m]: change of a pair below which it is not sent again in compact mode
+#define DEFAULT_COMPACT_KEYFRAME_INTERVAL 10 // number of cycles after which all pairs are sent again in compact mode
+
+#define DEFAULT_COMPUTATION_RATE 20.0 // [Hz]: rate of the distance computation loop
+#define DEFAULT_SPINNER_THREADS 2 // number of threads serving joint state, obstacle and registration callbacks
+
 #define DEFAULT_COL_ALPHA 0.6 // MoveIt! CollisionGeometry does not provide color -> Therefore use default value. 0.5 = Test for taking pictures -> robot arm should be visible behind obstacle
 
 struct ShapeMsgTypeToVisMarkerType
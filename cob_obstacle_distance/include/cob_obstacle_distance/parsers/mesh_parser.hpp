@@ -26,12 +26,9 @@
 
 class MeshParser : public ParserBase
 {
-    private:
-        int8_t toVec3f(uint32_t num_current_face, aiVector3D* vertex, fcl::Vec3f& out);
-
     public:
-        MeshParser(const std::string& file_path)
-        : ParserBase(file_path)
+        MeshParser(const std::string& file_path, bool deduplicate_vertices = false)
+        : ParserBase(file_path, deduplicate_vertices)
         {
 
         }
@@ -41,7 +38,9 @@ class MeshParser : public ParserBase
 
         }
 
-        int8_t read(std::vector<TriangleSupport>& tri_vec);
+        using ParserBase::read;
+
+        int8_t read(std::vector<fcl::Vec3f>& vertices, std::vector<fcl::Triangle>& triangles);
 };
 
 #endif /* MESH_PARSER_HPP_ */
@@ -19,8 +19,14 @@
 #define PARSER_BASE_HPP_
 
 #include <stdint.h>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
 #include <fcl/BVH/BVH_model.h>
 #include <fcl/math/vec_3f.h>
+#include <fcl/data_types.h>
 
 #include "cob_obstacle_distance/obstacle_distance_data_types.hpp"
 
@@ -28,14 +34,68 @@ class ParserBase
 {
     protected:
         std::string file_path_;
+        bool deduplicate_vertices_;  ///< merge bit-identical vertices into one index
+
+        /// Bit-exact vertex coordinates as lookup key for the deduplication.
+        struct VertexKey
+        {
+            double xyz_[3];
+
+            bool operator==(const VertexKey& other) const
+            {
+                return 0 == std::memcmp(this->xyz_, other.xyz_, sizeof(this->xyz_));
+            }
+        };
+
+        struct VertexKeyHash
+        {
+            size_t operator()(const VertexKey& key) const
+            {
+                std::hash<double> hasher;
+                size_t seed = hasher(key.xyz_[0]);
+                seed ^= hasher(key.xyz_[1]) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+                seed ^= hasher(key.xyz_[2]) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+                return seed;
+            }
+        };
+
+        /// key: vertex, value: its index in the vertex buffer
+        typedef std::unordered_map<VertexKey, uint32_t, VertexKeyHash> VertexIndexMap_t;
+
+        /**
+         * Appends a vertex to the vertex buffer or returns the index of an identical one if deduplication is enabled.
+         * @param v The vertex.
+         * @param index_map Lookup of already added vertices (only used with deduplication).
+         * @param vertices The vertex buffer.
+         * @return The index of the vertex in the vertex buffer.
+         */
+        uint32_t addVertex(const fcl::Vec3f& v, VertexIndexMap_t& index_map, std::vector<fcl::Vec3f>& vertices) const
+        {
+            if (!this->deduplicate_vertices_)
+            {
+                vertices.push_back(v);
+                return vertices.size() - 1;
+            }
+
+            const VertexKey key = {{v[0], v[1], v[2]}};
+            std::pair<VertexIndexMap_t::iterator, bool> res = index_map.insert(std::make_pair(key, vertices.size()));
+            if (res.second)
+            {
+                vertices.push_back(v);
+            }
+
+            return res.first->second;
+        }
 
     public:
         /**
          * Base class ctor
          * @param file_path Can be an URI name (e.g. package:// ...) or a full path.
+         * @param deduplicate_vertices Whether identical vertices shall share one index in the vertex buffer.
          */
-        ParserBase(const std::string& file_path)
-        : file_path_(file_path)
+        ParserBase(const std::string& file_path, bool deduplicate_vertices = false)
+        : file_path_(file_path),
+          deduplicate_vertices_(deduplicate_vertices)
         {
 
         }
@@ -54,12 +114,39 @@ class ParserBase
             return this->file_path_;
         }
 
+        /**
+         * Tries to read from the given file path and fills an indexed triangle mesh.
+         * @param vertices The vertex buffer that shall be filled by the read method.
+         * @param triangles The index buffer (three vertex indices per triangle) that shall be filled by the read method.
+         * @return Success status (0 means ok)
+         */
+        virtual int8_t read(std::vector<fcl::Vec3f>& vertices, std::vector<fcl::Triangle>& triangles) = 0;
+
         /**
          * Tries to read from the given file path and fills a triangle vector.
          * @param tri_vec A vector of triangles that shall be filled by the read method.
          * @return Success status (0 means ok)
          */
-        virtual int8_t read(std::vector<TriangleSupport>& tri_vec) = 0;
+        int8_t read(std::vector<TriangleSupport>& tri_vec)
+        {
+            std::vector<fcl::Vec3f> vertices;
+            std::vector<fcl::Triangle> triangles;
+            int8_t success = this->read(vertices, triangles);
+            if (0 == success)
+            {
+                tri_vec.reserve(tri_vec.size() + triangles.size());
+                for (std::vector<fcl::Triangle>::const_iterator it = triangles.begin(); it != triangles.end(); ++it)
+                {
+                    TriangleSupport t;
+                    t.a = vertices[(*it)[0]];
+                    t.b = vertices[(*it)[1]];
+                    t.c = vertices[(*it)[2]];
+                    tri_vec.push_back(t);
+                }
+            }
+
+            return success;
+        }
 
         template <typename T>
         int8_t createBVH(fcl::BVHModel<T>& bvh);
@@ -79,15 +166,12 @@ template <typename T>
 int8_t ParserBase::createBVH(fcl::BVHModel<T>& bvh)
 {
     int8_t success = -1;
-    std::vector<TriangleSupport> tri_vec;
-    if(0 == this->read(tri_vec))
+    std::vector<fcl::Vec3f> vertices;
+    std::vector<fcl::Triangle> triangles;
+    if(0 == this->read(vertices, triangles))
     {
-        bvh.beginModel();
-        for(TriangleSupport t :  tri_vec)
-        {
-            bvh.addTriangle(t.a, t.b, t.c);
-        }
-
+        bvh.beginModel(triangles.size(), vertices.size());
+        bvh.addSubModel(vertices, triangles);
         bvh.endModel();
         bvh.computeLocalAABB();
         success = 0;
@@ -99,22 +183,7 @@ int8_t ParserBase::createBVH(fcl::BVHModel<T>& bvh)
 template <typename T>
 int8_t ParserBase::createBVH(std::shared_ptr<fcl::BVHModel<T> > ptr_bvh)
 {
-    int8_t success = -1;
-    std::vector<TriangleSupport> tri_vec;
-    if(0 == this->read(tri_vec))
-    {
-        ptr_bvh->beginModel();
-        for(TriangleSupport t :  tri_vec)
-        {
-            ptr_bvh->addTriangle(t.a, t.b, t.c);
-        }
-
-        ptr_bvh->endModel();
-        ptr_bvh->computeLocalAABB();
-        success = 0;
-    }
-
-    return success;
+    return this->createBVH(*ptr_bvh);
 }
 
 
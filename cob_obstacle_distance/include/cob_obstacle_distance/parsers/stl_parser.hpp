@@ -23,14 +23,31 @@
 class StlParser : public ParserBase
 {
     private:
+        /**
+         * Decodes a binary STL file in one pass over the mapped file content.
+         * @param data Pointer to the file content.
+         * @param size Size of the file content in bytes.
+         * @param vertices The vertex buffer.
+         * @param triangles The index buffer.
+         * @return Success status (0 means ok).
+         */
+        int8_t readBinary(const char* data, size_t size, std::vector<fcl::Vec3f>& vertices, std::vector<fcl::Triangle>& triangles);
 
-        double toDouble(char* facet, uint8_t start_idx);
+        /**
+         * Parses an ASCII STL file ("solid ... facet normal ... outer loop vertex x y z ...").
+         * @param data Pointer to the file content.
+         * @param size Size of the file content in bytes.
+         * @param vertices The vertex buffer.
+         * @param triangles The index buffer.
+         * @return Success status (0 means ok).
+         */
+        int8_t readAscii(const char* data, size_t size, std::vector<fcl::Vec3f>& vertices, std::vector<fcl::Triangle>& triangles);
 
-        fcl::Vec3f toVec3f(char* facet);
+        fcl::Vec3f toVec3f(const char* facet) const;
 
     public:
-        StlParser(const std::string& file_path)
-        : ParserBase(file_path)
+        StlParser(const std::string& file_path, bool deduplicate_vertices = false)
+        : ParserBase(file_path, deduplicate_vertices)
         {
 
         }
@@ -40,7 +57,9 @@ class StlParser : public ParserBase
 
         }
 
-        int8_t read(std::vector<TriangleSupport>& tri_vec);
+        using ParserBase::read;
+
+        int8_t read(std::vector<fcl::Vec3f>& vertices, std::vector<fcl::Triangle>& triangles);
 };
 
 #endif /* STL_PARSER_HPP_ */
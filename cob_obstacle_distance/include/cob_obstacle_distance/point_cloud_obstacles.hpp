@@ -0,0 +1,88 @@
+/*
+ * Copyright 2017 Fraunhofer Institute for Manufacturing Engineering and Automation (IPA)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef POINT_CLOUD_OBSTACLES_HPP_
+#define POINT_CLOUD_OBSTACLES_HPP_
+
+#include <stdint.h>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <ros/ros.h>
+#include <tf/transform_datatypes.h>
+#include <sensor_msgs/PointCloud2.h>
+
+#include <fcl/BV/AABB.h>
+#include <fcl/math/vec_3f.h>
+
+/// Occupied voxels from live point clouds. Clouds are downsampled to a voxel grid in a single streaming pass,
+/// voxels that have not been observed for the decay time are dropped again. The decay is also applied by the queries,
+/// so that voxels expire even if no new clouds arrive.
+class PointCloudObstacles
+{
+    public:
+        /// Immutable state of the occupied voxels for the distance computation. Replaced as a whole after each cloud.
+        struct Snapshot
+        {
+            std::vector<fcl::Vec3f> points_;  ///< centers of the occupied voxels (root frame)
+            std::vector<ros::Time> stamps_;  ///< last observation of each voxel in points_
+            std::unordered_map<uint64_t, std::vector<uint32_t> > buckets_;  ///< coarse spatial hash: indices into points_
+            double bucket_size_;
+            double voxel_size_;
+            double decay_time_;
+
+            /**
+             * Collects all occupied voxel centers within an axis aligned box that have not decayed yet.
+             * @param box The box (root frame).
+             * @param now The current time.
+             * @param indices The indices into points_.
+             */
+            void getPointsWithin(const fcl::AABB& box, const ros::Time& now, std::vector<uint32_t>& indices) const;
+        };
+
+        /**
+         * @param voxel_size Edge length of the voxels in [m].
+         * @param decay_time Duration in [s] after which a voxel that has not been observed again is dropped.
+         * @param bucket_size Edge length in [m] of the coarse spatial hash for the distance queries.
+         */
+        PointCloudObstacles(double voxel_size, double decay_time, double bucket_size);
+
+        /**
+         * Inserts all points of a cloud and drops decayed voxels.
+         * @param cloud The point cloud (fields x, y and z as float32).
+         * @param root_from_cloud The transformation from the cloud frame into the root frame.
+         */
+        void insert(const sensor_msgs::PointCloud2& cloud, const tf::Transform& root_from_cloud);
+
+        std::shared_ptr<const Snapshot> getSnapshot();
+
+        static uint64_t toKey(int32_t x, int32_t y, int32_t z);
+
+    private:
+        double voxel_size_;
+        double decay_time_;
+        double bucket_size_;
+
+        std::unordered_map<uint64_t, ros::Time> voxels_;  ///< first: voxel key, second: stamp of the last observation
+
+        std::mutex snapshot_mtx_;
+        std::shared_ptr<const Snapshot> snapshot_;
+};
+
+#endif /* POINT_CLOUD_OBSTACLES_HPP_ */
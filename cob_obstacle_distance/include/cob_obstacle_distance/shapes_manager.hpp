@@ -19,9 +19,13 @@
 #define SHAPES_MANAGER_HPP_
 
 #include <ros/ros.h>
+#include <string>
+#include <vector>
 #include <unordered_map>
 
 #include <visualization_msgs/MarkerArray.h>
+#include <fcl/collision_object.h>
+#include <fcl/broadphase/broadphase_dynamic_AABB_tree.h>
 #include "cob_obstacle_distance/marker_shapes/marker_shapes_interface.hpp"
 
 /// Class to manage fcl::Shapes and connect with RVIZ marker type.
@@ -29,8 +33,20 @@ class ShapesManager
 {
     private:
         std::unordered_map<std::string, PtrIMarkerShape_t> shapes_;
+        fcl::DynamicAABBTreeCollisionManager broadphase_;
+        bool broadphase_changed_;
+        std::vector<visualization_msgs::Marker> deleted_markers_;  ///< DELETE markers of removed shapes, sent with the next draw
         const ros::Publisher& pub_;
 
+        /**
+         * Callback for the broad-phase: collects the ids of all shapes whose AABB overlaps the query AABB.
+         */
+        static bool collectCandidates(fcl::CollisionObject* o1, fcl::CollisionObject* o2, void* cdata);
+
+        void registerBroadphase(const std::string& id);
+
+        void unregisterBroadphase(const std::string& id);
+
     public:
         typedef std::unordered_map<std::string, PtrIMarkerShape_t>::iterator MapIter_t;
         typedef std::unordered_map<std::string, PtrIMarkerShape_t>::const_iterator MapConstIter_t;
@@ -52,6 +68,7 @@ class ShapesManager
 
         /**
          * Removes a shape from the manager.
+         * The marker is deleted in RVIZ with the next call of draw().
          * @param id Key to access the marker shape.
          */
         void removeShape(const std::string& id);
@@ -67,7 +84,8 @@ class ShapesManager
 
 
         /**
-         * Draw the marker managed by the ShapesManager
+         * Draw the marker managed by the ShapesManager.
+         * The markers of the shapes removed since the last call are deleted within the same marker array.
          */
         void draw();
 
@@ -88,6 +106,27 @@ class ShapesManager
          */
         uint32_t count(const std::string& id) const;
 
+        /**
+         * Synchronizes the broad-phase with the current poses of the managed shapes.
+         * Only the shapes that moved since the last call are refitted in the AABB tree.
+         */
+        void updateBroadphase();
+
+        /**
+         * Broad-phase query: Returns the ids of the shapes whose AABB is closer than max_distance to the given AABB.
+         * @param aabb Axis aligned bounding box (in root frame) of the query object.
+         * @param max_distance Cutoff distance. Shapes further away are culled.
+         * @param ids The ids of the candidate shapes for the narrow-phase.
+         */
+        void getCandidates(const fcl::AABB& aabb, double max_distance, std::vector<std::string>& ids);
+
+        /**
+         * Returns the persistent collision object of a shape as it is registered in the broad-phase.
+         * @param id Key to access the marker shape.
+         * @return Pointer to the collision object or NULL if the id is unknown.
+         */
+        fcl::CollisionObject* getCollisionObject(const std::string& id);
+
 
         MapIter_t begin() {return this->shapes_.begin(); }
         MapConstIter_t begin() const {return this->shapes_.begin(); }
@@ -0,0 +1,155 @@
+/*
+ * Copyright 2017 Fraunhofer Institute for Manufacturing Engineering and Automation (IPA)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef STATIC_DISTANCE_FIELD_HPP_
+#define STATIC_DISTANCE_FIELD_HPP_
+
+#include <stdint.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <fcl/collision_object.h>
+#include <fcl/math/vec_3f.h>
+
+/// Signed distance fields of the static obstacles on regular voxel grids, one grid per obstacle.
+/// Each grid covers the surface voxels of its obstacle plus the margin, so memory grows with the obstacles and not with
+/// the space between them, and every obstacle gets its own distance. When an obstacle is set, only its grid is rebuilt
+/// by an exact Euclidean distance transform. Rebuilds run in a background thread; finished grids are swapped in by
+/// update(), queries keep using the previous ones meanwhile.
+class StaticDistanceField
+{
+    private:
+        /// Integer coordinates of a voxel on the global lattice (voxel center at (key + 0.5) * resolution).
+        struct VoxelKey
+        {
+            int32_t x_;
+            int32_t y_;
+            int32_t z_;
+
+            bool operator<(const VoxelKey& other) const
+            {
+                return x_ < other.x_ || (x_ == other.x_ && (y_ < other.y_ || (y_ == other.y_ && z_ < other.z_)));
+            }
+
+            bool operator==(const VoxelKey& other) const
+            {
+                return x_ == other.x_ && y_ == other.y_ && z_ == other.z_;
+            }
+        };
+
+        /// Surface voxels of one obstacle, waiting to be transformed. The generation changes whenever the obstacle is rasterized again.
+        struct Obstacle
+        {
+            std::vector<VoxelKey> voxels_;
+            uint32_t generation_;
+        };
+
+        /// Immutable distance field of one obstacle.
+        struct Grid
+        {
+            VoxelKey origin_;  ///< lattice key of the grid voxel (0, 0, 0)
+            int32_t size_[3];
+            std::vector<float> distance_;  ///< signed distance [m] at the voxel centers (negative inside the obstacle)
+            uint32_t generation_;  ///< generation of the obstacle this grid was built from
+
+            inline size_t index(int32_t x, int32_t y, int32_t z) const
+            {
+                return (static_cast<size_t>(z) * this->size_[1] + y) * this->size_[0] + x;
+            }
+        };
+
+        typedef std::unordered_map<std::string, Obstacle> Obstacles_t;
+        typedef std::unordered_map<std::string, std::shared_ptr<const Grid> > Grids_t;
+
+        double resolution_;
+        double margin_;
+        uint32_t next_generation_;
+
+        std::unordered_map<std::string, uint32_t> generations_;  ///< current generation of each obstacle (changed by the owner only)
+        Obstacles_t pending_;  ///< rasterized obstacles not handed to the builder yet (changed by the owner only)
+        Grids_t grids_;  ///< grids used by the queries (changed by update() only)
+
+        std::thread builder_;
+        std::mutex build_mtx_;
+        std::condition_variable build_cv_;
+        bool stop_builder_;
+        Obstacles_t build_input_;  ///< obstacles for the next rebuilds, only the latest generation of each is kept
+        Grids_t built_;  ///< finished grids, not swapped in yet
+
+        void buildLoop();
+
+        std::shared_ptr<const Grid> build(const Obstacle& obstacle) const;
+
+        /**
+         * 1D squared Euclidean distance transform of one grid line (Felzenszwalb and Huttenlocher).
+         */
+        static void transformLine(std::vector<double>& f, size_t offset, size_t stride, int32_t n,
+                                  std::vector<double>& line_f, std::vector<int32_t>& v, std::vector<double>& z);
+
+    public:
+        /**
+         * @param resolution The edge length of a voxel in [m].
+         * @param margin The distance in [m] around each obstacle that is covered by its grid.
+         */
+        StaticDistanceField(double resolution, double margin);
+
+        ~StaticDistanceField();
+
+        /**
+         * Rasterizes the surface of an obstacle at its current pose (replaces a previous version of the obstacle).
+         * @param id The id of the obstacle.
+         * @param collision_object The collision object of the obstacle (BVH models only).
+         * @return Whether the obstacle could be rasterized.
+         */
+        bool setObstacle(const std::string& id, const fcl::CollisionObject& collision_object);
+
+        void removeObstacle(const std::string& id);
+
+        /**
+         * @return Whether the grids in use contain the current version of the obstacle. Otherwise the obstacle has to be
+         *         handled by the narrow phase.
+         */
+        bool contains(const std::string& id) const;
+
+        inline double getMargin() const
+        {
+            return this->margin_;
+        }
+
+        /**
+         * Swaps in the finished grids and hands the obstacles that have been set since to the background rebuild.
+         */
+        void update();
+
+        /**
+         * Lookup of the signed distance to one obstacle and its gradient (trilinear).
+         * @param id The id of the obstacle.
+         * @param p The query point (root frame).
+         * @param distance A lower bound of the signed distance to the obstacle in [m]
+         *                 (underestimates by up to about sqrt(3) * resolution).
+         * @param gradient The gradient of the distance (points away from the obstacle).
+         * @return False if the obstacle has no grid or the point is not within it, i.e. farther than the margin from the obstacle.
+         */
+        bool query(const std::string& id, const fcl::Vec3f& p, double& distance, fcl::Vec3f& gradient) const;
+};
+
+#endif /* STATIC_DISTANCE_FIELD_HPP_ */
@@ -0,0 +1,92 @@
+/*
+ * Copyright 2017 Fraunhofer Institute for Manufacturing Engineering and Automation (IPA)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "cob_obstacle_distance/chainfk_solvers/advanced_treefksolver.hpp"
+
+AdvancedTreeFkSolverVel::AdvancedTreeFkSolverVel(const KDL::Tree& tree)
+    : nr_of_joints_(tree.getNrOfJoints())
+{
+    // depth first: a segment is indexed when it is taken from the stack, its parent has been indexed before
+    std::vector<std::pair<KDL::SegmentMap::const_iterator, int32_t> > stack;
+    stack.push_back(std::make_pair(tree.getRootSegment(), -1));
+    while (!stack.empty())
+    {
+        const KDL::SegmentMap::const_iterator element = stack.back().first;
+        const int32_t parent = stack.back().second;
+        stack.pop_back();
+
+        const uint32_t idx = this->segments_.size();
+        const KDL::Segment& segment = GetTreeElementSegment(element->second);
+        const bool moving = KDL::Joint::None != segment.getJoint().getType();
+        this->segments_.push_back(segment);
+        this->parents_.push_back(parent);
+        this->q_nrs_.push_back(moving ? static_cast<int32_t>(GetTreeElementQNr(element->second)) : -1);
+        this->local_frames_.push_back(KDL::FrameVel(segment.pose(0.0), segment.twist(0.0, 0.0)));
+        this->indices_[element->first] = idx;
+
+        const std::vector<KDL::SegmentMap::const_iterator>& children = GetTreeElementChildren(element->second);
+        for (std::vector<KDL::SegmentMap::const_iterator>::const_reverse_iterator it = children.rbegin(); it != children.rend(); ++it)
+        {
+            stack.push_back(std::make_pair(*it, static_cast<int32_t>(idx)));
+        }
+    }
+
+    this->frames_.assign(this->segments_.size(), KDL::FrameVel::Identity());
+}
+
+/**
+ * Calculates the frames of all segments in one pass over the topologically sorted segments.
+ */
+int AdvancedTreeFkSolverVel::JntToCart(const KDL::JntArrayVel& q_in)
+{
+    if (q_in.q.rows() != this->nr_of_joints_ || q_in.qdot.rows() != this->nr_of_joints_)
+    {
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < this->segments_.size(); ++i)
+    {
+        const int32_t q_nr = this->q_nrs_[i];
+        if (q_nr >= 0)
+        {
+            this->local_frames_[i] = KDL::FrameVel(this->segments_[i].pose(q_in.q(q_nr)),
+                                                   this->segments_[i].twist(q_in.q(q_nr), q_in.qdot(q_nr)));
+        }
+
+        const int32_t parent = this->parents_[i];
+        this->frames_[i] = parent < 0 ? this->local_frames_[i] : this->frames_[parent] * this->local_frames_[i];
+    }
+
+    return 0;
+}
+
+
+int AdvancedTreeFkSolverVel::getSegmentIndex(const std::string& segment_name) const
+{
+    std::unordered_map<std::string, uint32_t>::const_iterator it = this->indices_.find(segment_name);
+    return it != this->indices_.end() ? static_cast<int>(it->second) : -1;
+}
+
+
+const KDL::FrameVel& AdvancedTreeFkSolverVel::getFrameVelAtSegment(uint32_t seg_idx) const
+{
+    return this->frames_.at(seg_idx);
+}
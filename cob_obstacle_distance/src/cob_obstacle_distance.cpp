@@ -16,6 +16,7 @@
 
 
 #include <ctime>
+#include <algorithm>
 #include <vector>
 #include <ros/ros.h>
 #include <fcl/shape/geometric_shapes.h>
@@ -50,16 +51,36 @@ int main(int argc, char** argv)
 
     ros::Subscriber jointstate_sub = nh.subscribe("joint_states", 1, &DistanceManager::jointstateCb, &sm);
     ros::Subscriber obstacle_sub = nh.subscribe("obstacle_distance/registerObstacle", 1, &DistanceManager::registerObstacle, &sm);
+    ros::Subscriber planning_scene_sub = nh.subscribe("obstacle_distance/registerPlanningScene", 10, &DistanceManager::registerPlanningScene, &sm);
+    ros::Subscriber pointcloud_sub = nh.subscribe("obstacle_distance/pointcloud", 1, &DistanceManager::pointcloudCb, &sm);
     ros::ServiceServer registration_srv = nh.advertiseService("obstacle_distance/registerLinkOfInterest" , &DistanceManager::registerLinkOfInterest, &sm);
 
-    ros::Rate loop_rate(20);
+    double computation_rate;
+    int spinner_threads;
+    nh.param("computation_rate", computation_rate, DEFAULT_COMPUTATION_RATE);
+    nh.param("spinner_threads", spinner_threads, DEFAULT_SPINNER_THREADS);
+    if (computation_rate <= 0.0)
+    {
+        ROS_ERROR_STREAM("Parameter \"computation_rate\" must be positive but is " << computation_rate << ".");
+        return -5;
+    }
+
+    // Callbacks are served in parallel, so that registration and joint states do not delay the computation loop.
+    ros::AsyncSpinner spinner(std::max(1, spinner_threads));
+    spinner.start();
+
+    ros::Rate loop_rate(computation_rate);
     while (ros::ok())
     {
         sm.calculate();
-        ros::spinOnce();
-        loop_rate.sleep();
+        if (!loop_rate.sleep())
+        {
+            ROS_WARN_STREAM_THROTTLE(5.0, "Distance computation cannot keep up with " << computation_rate << " Hz. Last cycle took " <<
+                                          loop_rate.cycleTime().toSec() * 1000.0 << " ms.");
+        }
     }
 
+    spinner.stop();
     return 0;
 }
 
@@ -0,0 +1,206 @@
+/*
+ * Copyright 2017 Fraunhofer Institute for Manufacturing Engineering and Automation (IPA)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "cob_obstacle_distance/compact_distance_encoder.hpp"
+
+/**
+ * Converts a vector message into the float array of the compact message.
+ */
+static void toArray(const geometry_msgs::Vector3& v, boost::array<float, 3>& a)
+{
+    a[0] = static_cast<float>(v.x);
+    a[1] = static_cast<float>(v.y);
+    a[2] = static_cast<float>(v.z);
+}
+
+static uint32_t toKey(uint16_t link_index, uint16_t obstacle_index)
+{
+    return (static_cast<uint32_t>(link_index) << 16) | obstacle_index;
+}
+
+
+CompactDistanceEncoder::CompactDistanceEncoder(double change_tolerance, uint32_t keyframe_interval)
+    : change_tolerance_(change_tolerance),
+      keyframe_interval_(std::max(1u, keyframe_interval)),
+      cycles_since_keyframe_(keyframe_interval_),
+      sequence_(0),
+      names_changed_(true)
+{
+    this->names_.version = 0;
+}
+
+
+bool CompactDistanceEncoder::encode(const std::vector<cob_control_msgs::ObstacleDistance>& distances,
+                                    cob_control_msgs::CompactObstacleDistances& msg)
+{
+    msg.distances.clear();
+    msg.released_link_indices.clear();
+    msg.released_obstacle_indices.clear();
+
+    bool keyframe = ++this->cycles_since_keyframe_ >= this->keyframe_interval_;
+    if (this->link_indices_.size() + distances.size() > std::numeric_limits<uint16_t>::max() ||
+        this->obstacle_indices_.size() + distances.size() > std::numeric_limits<uint16_t>::max())
+    {
+        // the indices would overflow with ids that have come and gone: start over with a new table
+        this->resetNames();
+        keyframe = true;
+    }
+
+    std::unordered_map<uint32_t, cob_control_msgs::CompactObstacleDistance> current;
+    current.reserve(distances.size());
+    for (std::vector<cob_control_msgs::ObstacleDistance>::const_iterator it = distances.begin(); it != distances.end(); ++it)
+    {
+        cob_control_msgs::CompactObstacleDistance c;
+        c.link_index = this->getIndex(it->link_of_interest, this->link_indices_, this->names_.links);
+        c.obstacle_index = this->getIndex(it->obstacle_id, this->obstacle_indices_, this->names_.obstacles);
+        c.distance = static_cast<float>(it->distance);
+        toArray(it->frame_vector, c.frame_vector);
+        toArray(it->nearest_point_frame_vector, c.nearest_point_frame_vector);
+        toArray(it->nearest_point_obstacle_vector, c.nearest_point_obstacle_vector);
+        c.contact_predicted = it->contact_predicted;
+        c.time_to_contact = static_cast<float>(it->time_to_contact);
+        current[toKey(c.link_index, c.obstacle_index)] = c;
+    }
+
+    if (keyframe)
+    {
+        this->cycles_since_keyframe_ = 0;
+        msg.distances.reserve(current.size());
+        for (std::unordered_map<uint32_t, cob_control_msgs::CompactObstacleDistance>::const_iterator it = current.begin(); it != current.end(); ++it)
+        {
+            msg.distances.push_back(it->second);
+        }
+
+        this->sent_.swap(current);
+    }
+    else
+    {
+        // the subscribers keep the last sent state of a pair, so changes are measured against it and not against the last cycle
+        std::unordered_map<uint32_t, cob_control_msgs::CompactObstacleDistance> sent;
+        sent.reserve(current.size());
+        for (std::unordered_map<uint32_t, cob_control_msgs::CompactObstacleDistance>::const_iterator it = current.begin(); it != current.end(); ++it)
+        {
+            std::unordered_map<uint32_t, cob_control_msgs::CompactObstacleDistance>::const_iterator sent_it = this->sent_.find(it->first);
+            if (sent_it == this->sent_.end() || this->hasChanged(sent_it->second, it->second))
+            {
+                msg.distances.push_back(it->second);
+                sent[it->first] = it->second;
+            }
+            else
+            {
+                sent[it->first] = sent_it->second;
+            }
+        }
+
+        for (std::unordered_map<uint32_t, cob_control_msgs::CompactObstacleDistance>::const_iterator it = this->sent_.begin(); it != this->sent_.end(); ++it)
+        {
+            if (current.count(it->first) == 0)
+            {
+                msg.released_link_indices.push_back(it->second.link_index);
+                msg.released_obstacle_indices.push_back(it->second.obstacle_index);
+            }
+        }
+
+        this->sent_.swap(sent);
+    }
+
+    msg.names_version = this->names_.version;
+    msg.keyframe = keyframe;
+    if (keyframe || !msg.distances.empty() || !msg.released_link_indices.empty())
+    {
+        msg.sequence = ++this->sequence_;
+        return true;
+    }
+
+    return false;
+}
+
+
+bool CompactDistanceEncoder::getChangedNames(cob_control_msgs::ObstacleDistanceNames& names)
+{
+    if (!this->names_changed_)
+    {
+        return false;
+    }
+
+    names.version = this->names_.version;
+    names.links = this->names_.links;
+    names.obstacles = this->names_.obstacles;
+    this->names_changed_ = false;
+    return true;
+}
+
+
+uint16_t CompactDistanceEncoder::getIndex(const std::string& name,
+                                          std::unordered_map<std::string, uint16_t>& indices,
+                                          std::vector<std::string>& table)
+{
+    std::unordered_map<std::string, uint16_t>::const_iterator it = indices.find(name);
+    if (it != indices.end())
+    {
+        return it->second;
+    }
+
+    const uint16_t index = static_cast<uint16_t>(table.size());
+    indices[name] = index;
+    table.push_back(name);
+    ++this->names_.version;
+    this->names_changed_ = true;
+    return index;
+}
+
+
+bool CompactDistanceEncoder::hasChanged(const cob_control_msgs::CompactObstacleDistance& sent,
+                                        const cob_control_msgs::CompactObstacleDistance& current) const
+{
+    if (std::abs(sent.distance - current.distance) > this->change_tolerance_ ||
+        sent.contact_predicted != current.contact_predicted ||
+        std::abs(sent.time_to_contact - current.time_to_contact) > this->change_tolerance_)
+    {
+        return true;
+    }
+
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        if (std::abs(sent.frame_vector[i] - current.frame_vector[i]) > this->change_tolerance_ ||
+            std::abs(sent.nearest_point_frame_vector[i] - current.nearest_point_frame_vector[i]) > this->change_tolerance_ ||
+            std::abs(sent.nearest_point_obstacle_vector[i] - current.nearest_point_obstacle_vector[i]) > this->change_tolerance_)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+void CompactDistanceEncoder::resetNames()
+{
+    this->link_indices_.clear();
+    this->obstacle_indices_.clear();
+    this->names_.links.clear();
+    this->names_.obstacles.clear();
+    ++this->names_.version;
+    this->names_changed_ = true;
+    this->sent_.clear();
+}
@@ -0,0 +1,219 @@
+/*
+ * Copyright 2017 Fraunhofer Institute for Manufacturing Engineering and Automation (IPA)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+//
+// Offline benchmark of the point cloud obstacles.
+//
+// A depth sensor stream is simulated: every cloud has 300k points (room, table and a moving box with sensor noise) and
+// the clouds are stamped at 15 Hz. For every cloud the insertion (transformation, downsampling, decay and snapshot) and
+// the voxel lookups of a set of link boxes are timed. The insertion has to stay within the cloud period.
+// Usage: point_cloud_obstacles_benchmark [points per cloud] [cloud rate] [number of clouds] [voxel size]
+//
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <ros/ros.h>
+#include <sensor_msgs/point_cloud2_iterator.h>
+
+#include "cob_obstacle_distance/point_cloud_obstacles.hpp"
+#include "cob_obstacle_distance/obstacle_distance_data_types.hpp"
+
+#define NUM_LINK_BOXES 20
+
+
+/// Collects latency samples and prints their distribution.
+class LatencyStatistics
+{
+    std::vector<double> samples_;
+
+    double percentile(double p) const
+    {
+        return this->samples_[std::min(static_cast<size_t>(p * this->samples_.size()), this->samples_.size() - 1)];
+    }
+
+public:
+    void add(double seconds)
+    {
+        this->samples_.push_back(seconds * 1000.0);
+    }
+
+    double max() const
+    {
+        return this->samples_.empty() ? 0.0 : *std::max_element(this->samples_.begin(), this->samples_.end());
+    }
+
+    void print(const std::string& name)
+    {
+        if (this->samples_.empty())
+        {
+            printf("  %-20s no samples\n", name.c_str());
+            return;
+        }
+
+        std::sort(this->samples_.begin(), this->samples_.end());
+        double sum = 0.0;
+        for (std::vector<double>::const_iterator it = this->samples_.begin(); it != this->samples_.end(); ++it)
+        {
+            sum += *it;
+        }
+
+        printf("  %-20s n=%-5u mean=%8.2f p50=%8.2f p90=%8.2f p99=%8.2f max=%8.2f [ms]\n", name.c_str(),
+               static_cast<unsigned int>(this->samples_.size()), sum / this->samples_.size(), this->percentile(0.5),
+               this->percentile(0.9), this->percentile(0.99), this->samples_.back());
+    }
+};
+
+
+/// Synthetic depth sensor: samples the visible surfaces of a static room and a box that moves with every cloud.
+class SceneGenerator
+{
+    std::mt19937 rng_;
+    std::uniform_real_distribution<float> unit_;
+    std::normal_distribution<float> noise_;
+
+public:
+    SceneGenerator()
+    : rng_(42),
+      unit_(0.0f, 1.0f),
+      noise_(0.0f, 0.005f)
+    {}
+
+    void generate(uint32_t num_points, uint32_t cloud_idx, double stamp, sensor_msgs::PointCloud2& cloud)
+    {
+        cloud.header.frame_id = "sensor";
+        cloud.header.stamp = ros::Time(stamp);
+        sensor_msgs::PointCloud2Modifier modifier(cloud);
+        modifier.setPointCloud2FieldsByString(1, "xyz");
+        modifier.resize(num_points);
+
+        const float box_x = 1.0f + 0.5f * std::sin(0.1f * cloud_idx);
+        sensor_msgs::PointCloud2Iterator<float> it_x(cloud, "x");
+        sensor_msgs::PointCloud2Iterator<float> it_y(cloud, "y");
+        sensor_msgs::PointCloud2Iterator<float> it_z(cloud, "z");
+        for (uint32_t i = 0; i < num_points; ++i, ++it_x, ++it_y, ++it_z)
+        {
+            const float u = this->unit_(this->rng_);
+            const float v = this->unit_(this->rng_);
+            const uint32_t surface = i % 10;
+            float x, y, z;
+            if (surface < 4)  // floor in front of the robot
+            {
+                x = 0.3f + 3.7f * u;
+                y = -2.0f + 4.0f * v;
+                z = 0.0f;
+            }
+            else if (surface < 6)  // wall
+            {
+                x = 4.0f;
+                y = -2.0f + 4.0f * u;
+                z = 2.5f * v;
+            }
+            else if (surface < 8)  // table top
+            {
+                x = 0.8f + 0.8f * u;
+                y = -0.6f + 1.2f * v;
+                z = 0.75f;
+            }
+            else  // front face of the moving box
+            {
+                x = box_x;
+                y = 0.8f + 0.4f * u;
+                z = 0.4f * v;
+            }
+
+            if (0 == i % 100)
+            {
+                x = y = z = std::numeric_limits<float>::quiet_NaN();  // invalid depth
+            }
+
+            *it_x = x + this->noise_(this->rng_);
+            *it_y = y + this->noise_(this->rng_);
+            *it_z = z + this->noise_(this->rng_);
+        }
+    }
+};
+
+
+int main(int argc, char** argv)
+{
+    const uint32_t num_points = argc > 1 ? std::atoi(argv[1]) : 300000;
+    const double rate = argc > 2 ? std::atof(argv[2]) : 15.0;
+    const uint32_t num_clouds = argc > 3 ? std::atoi(argv[3]) : 150;
+    const double voxel_size = argc > 4 ? std::atof(argv[4]) : DEFAULT_POINT_CLOUD_VOXEL_SIZE;
+    if (0 == num_points || rate <= 0.0 || 0 == num_clouds || voxel_size <= 0.0)
+    {
+        printf("Usage: %s [points per cloud] [cloud rate] [number of clouds] [voxel size]\n", argv[0]);
+        return 1;
+    }
+
+    PointCloudObstacles obstacles(voxel_size, DEFAULT_POINT_CLOUD_DECAY_TIME, std::max(voxel_size, 0.5 * MIN_DISTANCE));
+    SceneGenerator scene;
+    tf::Transform root_from_cloud;
+    root_from_cloud.setIdentity();
+
+    // boxes of the size of an arm link along a path over the table, expanded by the query distance
+    std::vector<fcl::AABB> link_boxes;
+    for (uint32_t i = 0; i < NUM_LINK_BOXES; ++i)
+    {
+        const fcl::Vec3f center(0.3 + 0.05 * i, -0.5 + 0.05 * i, 0.8 + 0.02 * i);
+        fcl::AABB box(center - fcl::Vec3f(0.1, 0.1, 0.15), center + fcl::Vec3f(0.1, 0.1, 0.15));
+        box.expand(fcl::Vec3f(MIN_DISTANCE, MIN_DISTANCE, MIN_DISTANCE));
+        link_boxes.push_back(box);
+    }
+
+    LatencyStatistics insert_stats, query_stats;
+    size_t num_voxels = 0, num_found = 0;
+    sensor_msgs::PointCloud2 cloud;
+    std::vector<uint32_t> indices;
+    for (uint32_t c = 0; c < num_clouds; ++c)
+    {
+        const double stamp = 1.0 + c / rate;
+        scene.generate(num_points, c, stamp, cloud);
+
+        ros::WallTime start_time = ros::WallTime::now();
+        obstacles.insert(cloud, root_from_cloud);
+        insert_stats.add((ros::WallTime::now() - start_time).toSec());
+
+        std::shared_ptr<const PointCloudObstacles::Snapshot> snapshot = obstacles.getSnapshot();
+        num_voxels = snapshot->points_.size();
+        start_time = ros::WallTime::now();
+        for (std::vector<fcl::AABB>::const_iterator it = link_boxes.begin(); it != link_boxes.end(); ++it)
+        {
+            snapshot->getPointsWithin(*it, ros::Time(stamp), indices);
+            num_found += indices.size();
+        }
+
+        query_stats.add((ros::WallTime::now() - start_time).toSec());
+    }
+
+    const double budget = 1000.0 / rate;
+    printf("%u clouds with %u points at %.1f Hz, voxel size %.3f m: %u occupied voxels, %.0f voxels per link box\n",
+           num_clouds, num_points, rate, voxel_size, static_cast<unsigned int>(num_voxels),
+           static_cast<double>(num_found) / (num_clouds * NUM_LINK_BOXES));
+    insert_stats.print("insert");
+    query_stats.print("lookup (all links)");
+    printf("  budget per cloud %.2f ms: %s\n", budget, insert_stats.max() < budget ? "kept" : "EXCEEDED");
+    return insert_stats.max() < budget ? 0 : 2;
+}
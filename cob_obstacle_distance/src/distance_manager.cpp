@@ -15,11 +15,14 @@
  */
 
 
+#include <algorithm>
+#include <cmath>
 #include <limits>
 #include <string>
 #include <vector>
 
 #include "cob_obstacle_distance/distance_manager.hpp"
+#include "cob_obstacle_distance/marker_shapes/mesh_cache.hpp"
 
 
 #include <stdint.h>
@@ -30,6 +33,7 @@
 #include <fcl/collision.h>
 #include <fcl/distance.h>
 #include <fcl/collision_data.h>
+#include <fcl/shape/geometric_shapes.h>
 
 #include <std_msgs/Float64.h>
 #include <visualization_msgs/Marker.h>
@@ -59,7 +63,103 @@
 
 uint32_t DistanceManager::seq_nr_ = 0;
 
-DistanceManager::DistanceManager(ros::NodeHandle& nh) : nh_(nh), stop_sca_threads_(false)
+/**
+ * Upper bound for the displacement of any point of a collision object since it had the given transform.
+ * @param obj The collision object at its current transform.
+ * @param last The transform of the collision object at the time of the reference.
+ * @return Maximal displacement of a point of the object geometry in [m].
+ */
+static double motionBound(const fcl::CollisionObject& obj, const fcl::Transform3f& last)
+{
+    const fcl::Transform3f& current = obj.getTransform();
+    const double translation = (current.getTranslation() - last.getTranslation()).length();
+
+    const fcl::Quaternion3f& q_c = current.getQuatRotation();
+    const fcl::Quaternion3f& q_l = last.getQuatRotation();
+    const double cos_half_angle = std::abs(q_c.getW() * q_l.getW() + q_c.getX() * q_l.getX() +
+                                           q_c.getY() * q_l.getY() + q_c.getZ() * q_l.getZ());
+    const double angle = 2.0 * std::acos(std::min(1.0, cos_half_angle));
+
+    // all points of the geometry lie within the bounding sphere around the local frame origin
+    const fcl::CollisionGeometry* geometry = obj.collisionGeometry().get();
+    const double radius = geometry->aabb_center.length() + geometry->aabb_radius;
+
+    return translation + angle * radius;
+}
+
+
+/**
+ * Appends the triangles of a BVH model to a mesh.
+ * @param bvh The BVH model in its local frame.
+ * @param part The transformation from the frame of the BVH model to the frame of the mesh.
+ * @param mesh The mesh the transformed triangles are appended to.
+ */
+static void appendToMesh(const BVH_RSS_t& bvh, const tf::Transform& part, shape_msgs::Mesh& mesh)
+{
+    const uint32_t offset = mesh.vertices.size();
+    for (int i = 0; i < bvh.num_vertices; ++i)
+    {
+        const tf::Vector3 v = part * tf::Vector3(bvh.vertices[i][0], bvh.vertices[i][1], bvh.vertices[i][2]);
+        geometry_msgs::Point pt;
+        tf::pointTFToMsg(v, pt);
+        mesh.vertices.push_back(pt);
+    }
+
+    for (int i = 0; i < bvh.num_tris; ++i)
+    {
+        shape_msgs::MeshTriangle tri;
+        for (uint32_t j = 0; j < 3; ++j)
+        {
+            tri.vertex_indices[j] = offset + bvh.tri_indices[i][j];
+        }
+
+        mesh.triangles.push_back(tri);
+    }
+}
+
+/**
+ * Appends the triangles of a mesh message to a mesh.
+ * @param part_mesh The mesh in its local frame.
+ * @param part The transformation from the frame of part_mesh to the frame of mesh.
+ * @param mesh The mesh the transformed triangles are appended to.
+ */
+static void appendToMesh(const shape_msgs::Mesh& part_mesh, const tf::Transform& part, shape_msgs::Mesh& mesh)
+{
+    const uint32_t offset = mesh.vertices.size();
+    for (std::vector<geometry_msgs::Point>::const_iterator it = part_mesh.vertices.begin(); it != part_mesh.vertices.end(); ++it)
+    {
+        tf::Vector3 v;
+        tf::pointMsgToTF(*it, v);
+        geometry_msgs::Point pt;
+        tf::pointTFToMsg(part * v, pt);
+        mesh.vertices.push_back(pt);
+    }
+
+    for (std::vector<shape_msgs::MeshTriangle>::const_iterator it = part_mesh.triangles.begin(); it != part_mesh.triangles.end(); ++it)
+    {
+        shape_msgs::MeshTriangle tri;
+        for (uint32_t j = 0; j < 3; ++j)
+        {
+            tri.vertex_indices[j] = offset + it->vertex_indices[j];
+        }
+
+        mesh.triangles.push_back(tri);
+    }
+}
+
+DistanceManager::DistanceManager(ros::NodeHandle& nh)
+    : stop_sca_threads_(false),
+      num_workers_(1),
+      work_cycle_(0),
+      pending_workers_(0),
+      stop_workers_(false),
+      chain_base_idx_(-1),
+      root_frame_idx_(-1),
+      nh_(nh),
+      cache_tolerance_(DEFAULT_CACHE_TOLERANCE),
+      lod_activation_distance_(MIN_DISTANCE),
+      closest_obstacles_per_link_(0),
+      continuous_horizon_(0.0)
 {}
 
 DistanceManager::~DistanceManager()
@@ -83,15 +183,9 @@ int DistanceManager::init()
         return -1;
     }
 
-    if (!nh_.getParam("joint_names", this->joints_))
-    {
-        ROS_ERROR("Failed to get parameter \"joint_names\".");
-        return -2;
-    }
-
     if (!nh_.getParam("root_frame", this->root_frame_id_))
     {
-        ROS_ERROR("Failed to get parameter \"chain_base_link\".");
+        ROS_ERROR("Failed to get parameter \"root_frame\".");
         return -3;
     }
 
@@ -101,29 +195,105 @@ int DistanceManager::init()
         return -3;
     }
 
-    if (!nh_.getParam("chain_tip_link", this->chain_tip_link_))
+    nh_.param("distance_cache_tolerance", this->cache_tolerance_, DEFAULT_CACHE_TOLERANCE);
+
+    // Level of detail for all shapes created from here on (self-collision, links and obstacles).
+    double lod_error_bound;
+    int lod_max_spheres;
+    nh_.param("lod_error_bound", lod_error_bound, DEFAULT_LOD_ERROR_BOUND);
+    nh_.param("lod_max_spheres", lod_max_spheres, DEFAULT_LOD_MAX_SPHERES);
+    nh_.param("lod_activation_distance", this->lod_activation_distance_, MIN_DISTANCE);
+    SphereProxy::setLevelOfDetail(lod_error_bound, static_cast<uint32_t>(std::max(1, lod_max_spheres)));
+
+    bool deduplicate_mesh_vertices;
+    nh_.param("deduplicate_mesh_vertices", deduplicate_mesh_vertices, false);
+    MeshCache::getInstance().setDeduplicateVertices(deduplicate_mesh_vertices);
+
+    bool static_obstacle_sdf;
+    double sdf_resolution;
+    nh_.param("static_obstacle_sdf", static_obstacle_sdf, false);
+    nh_.param("sdf_resolution", sdf_resolution, DEFAULT_SDF_RESOLUTION);
+    if (static_obstacle_sdf && lod_error_bound <= 0.0)
+    {
+        // the field is queried with the sphere proxies of the links, without them its obstacles would be ignored
+        ROS_ERROR("Parameter \"static_obstacle_sdf\" requires \"lod_error_bound\" > 0. The distance field is disabled.");
+    }
+    else if (static_obstacle_sdf && sdf_resolution > 0.0)
+    {
+        // the grids also cover the proxy spheres whose surface is within MIN_DISTANCE but whose center is not
+        this->static_field_.reset(new StaticDistanceField(sdf_resolution, MIN_DISTANCE + lod_error_bound));
+    }
+
+    bool pointcloud_obstacles;
+    double pointcloud_voxel_size;
+    double pointcloud_decay_time;
+    nh_.param("pointcloud_obstacles", pointcloud_obstacles, false);
+    nh_.param("pointcloud_voxel_size", pointcloud_voxel_size, DEFAULT_POINT_CLOUD_VOXEL_SIZE);
+    nh_.param("pointcloud_decay_time", pointcloud_decay_time, DEFAULT_POINT_CLOUD_DECAY_TIME);
+    if (pointcloud_obstacles && pointcloud_voxel_size > 0.0)
+    {
+        this->point_cloud_obstacles_.reset(new PointCloudObstacles(pointcloud_voxel_size,
+                                                                   pointcloud_decay_time,
+                                                                   std::max(pointcloud_voxel_size, 0.5 * MIN_DISTANCE)));
+    }
+
+    bool compact_output;
+    double compact_change_tolerance;
+    int compact_keyframe_interval;
+    int closest_obstacles_per_link;
+    nh_.param("compact_output", compact_output, false);
+    nh_.param("compact_change_tolerance", compact_change_tolerance, DEFAULT_COMPACT_CHANGE_TOLERANCE);
+    nh_.param("compact_keyframe_interval", compact_keyframe_interval, DEFAULT_COMPACT_KEYFRAME_INTERVAL);
+    nh_.param("closest_obstacles_per_link", closest_obstacles_per_link, 0);
+    this->closest_obstacles_per_link_ = static_cast<uint32_t>(std::max(0, closest_obstacles_per_link));
+    if (compact_output)
     {
-        ROS_ERROR("Failed to get parameter \"chain_tip_link\".");
-        return -4;
+        this->compact_encoder_.reset(new CompactDistanceEncoder(compact_change_tolerance,
+                                                                static_cast<uint32_t>(std::max(1, compact_keyframe_interval))));
+        this->compact_distances_pub_ = this->nh_.advertise<cob_control_msgs::CompactObstacleDistances>("obstacle_distance/compact", 1);
+        this->distance_names_pub_ = this->nh_.advertise<cob_control_msgs::ObstacleDistanceNames>("obstacle_distance/names", 1, true);
     }
 
-    robot_structure.getChain(this->chain_base_link_, this->chain_tip_link_, this->chain_);
-    if (chain_.getNrOfJoints() == 0)
+    bool continuous_collision;
+    double computation_rate;
+    nh_.param("continuous_collision", continuous_collision, false);
+    nh_.param("computation_rate", computation_rate, DEFAULT_COMPUTATION_RATE);
+    nh_.param("continuous_horizon", this->continuous_horizon_, 1.0 / std::max(computation_rate, 1.0));
+    if (!continuous_collision)
     {
-        ROS_ERROR("Failed to initialize kinematic chain");
+        this->continuous_horizon_ = 0.0;
+    }
+
+    int num_workers;
+    nh_.param("num_workers", num_workers, static_cast<int>(std::thread::hardware_concurrency()));
+    this->num_workers_ = static_cast<uint16_t>(std::max(1, num_workers));
+
+    // All links of the robot are computed by tree FK, the chain base link is only the reference frame of the distances.
+    this->tree_ = robot_structure;
+    tree_fk_solver_.reset(new AdvancedTreeFkSolverVel(this->tree_));
+    this->chain_base_idx_ = tree_fk_solver_->getSegmentIndex(this->chain_base_link_);
+    if (this->chain_base_idx_ < 0)
+    {
+        ROS_ERROR_STREAM("Chain base link " << this->chain_base_link_ << " is not part of the robot tree.");
         return -5;
     }
 
-    for (uint16_t i = 0; i < chain_.getNrOfSegments(); ++i)
+    this->root_frame_idx_ = tree_fk_solver_->getSegmentIndex(this->root_frame_id_);
+    for (KDL::SegmentMap::const_iterator it = this->tree_.getSegments().begin(); it != this->tree_.getSegments().end(); ++it)
     {
-        KDL::Segment s = chain_.getSegment(i);
-        this->segments_.push_back(s.getName());
-        ROS_INFO_STREAM("Managing Segment Name: " << s.getName());
+        const KDL::Joint& joint = GetTreeElementSegment(it->second).getJoint();
+        if (KDL::Joint::None != joint.getType())
+        {
+            this->tree_joint_idx_[joint.getName()] = GetTreeElementQNr(it->second);
+        }
     }
 
-    adv_chn_fk_solver_vel_.reset(new AdvancedChainFkSolverVel_recursive(chain_));
-    last_q_ = KDL::JntArray(chain_.getNrOfJoints());
-    last_q_dot_ = KDL::JntArray(chain_.getNrOfJoints());
+    ROS_INFO_STREAM("Managing " << tree_fk_solver_->getNrOfSegments() << " links with " << tree_fk_solver_->getNrOfJoints() <<
+                    " joints by tree FK" << (this->root_frame_idx_ < 0 ? "." : " (root frame is a link: no tf needed)."));
+
+    tree_q_ = KDL::JntArray(this->tree_.getNrOfJoints());
+    tree_q_dot_ = KDL::JntArray(this->tree_.getNrOfJoints());
+    tree_q_cycle_ = KDL::JntArrayVel(this->tree_.getNrOfJoints());
     if (!this->link_to_collision_.initParameter(this->root_frame_id_, "/robot_description"))
     {
         ROS_ERROR("Failed to initialize robot model from URDF by parameter \"/robot_description\".");
@@ -143,25 +313,37 @@ int DistanceManager::init()
             ROS_WARN("Parameter 'self_collision_map' not found or map empty.");
         }
 
+        // Self-collision obstacles are robot links: their poses are computed from the joint states by tree FK.
         for (LinkToCollision::MapSelfCollisions_t::iterator it = this->link_to_collision_.getSelfCollisionsIterBegin();
                 it != this->link_to_collision_.getSelfCollisionsIterEnd();
                 it++)
         {
-            self_collision_transform_threads_.push_back(std::thread(&DistanceManager::transformSelfCollisionLinks, this, it->first));
+            const int idx = this->tree_fk_solver_->getSegmentIndex(it->first);
+            if (idx < 0)
+            {
+                ROS_WARN_STREAM("Self-collision link " << it->first << " is not part of the robot tree. Its pose will not be updated.");
+                continue;
+            }
+
+            this->self_collision_links_.push_back(it->first);
+            this->self_collision_idx_.push_back(static_cast<uint32_t>(idx));
         }
     }
 
+    this->stop_workers_ = false;
+    for (uint16_t i = 1; i < this->num_workers_; ++i)
+    {
+        this->workers_.push_back(std::thread(&DistanceManager::calculateWorker, this, i));
+    }
+
+    ROS_INFO_STREAM("Distance computation partitioned across " << this->num_workers_ << " worker(s).");
     return 0;
 }
 
 void DistanceManager::clear()
 {
     this->stop_sca_threads_ = true;
-    for (std::vector<std::thread>::iterator it = this->self_collision_transform_threads_.begin();
-            it != this->self_collision_transform_threads_.end(); it++)
-    {
-        it->join();
-    }
+    this->stopWorkers();
 
     this->obstacle_mgr_->clear();
     this->object_of_interest_mgr_->clear();
@@ -195,238 +377,714 @@ void DistanceManager::drawObjectsOfInterest()
 void DistanceManager::calculate()
 {
     cob_control_msgs::ObstacleDistances obstacle_distances;
+    ros::WallTime start_time = ros::WallTime::now();
+    uint32_t num_pairs = 0;
+    uint32_t num_queries = 0;
+    uint32_t num_reused = 0;
+    uint32_t num_skipped = 0;
+    uint32_t num_coarse = 0;
+    uint32_t num_field = 0;
+    uint32_t num_cloud_points = 0;
+
+    std::lock_guard<std::mutex> ooi_lock(object_of_interest_mgr_mtx_);
+    if (this->object_of_interest_mgr_->count() <= 0)
+    {
+        return;
+    }
 
-    // Transform needs to be calculated only once for robot structure
-    // and is same for all obstacles.
-    if (this->object_of_interest_mgr_->count() > 0)
     {
-        KDL::FrameVel p_dot_out;
-        KDL::JntArrayVel jnt_arr(last_q_, last_q_dot_);
-        adv_chn_fk_solver_vel_->JntToCart(jnt_arr, p_dot_out);
+        std::lock_guard<std::mutex> lock(joint_state_mtx_);
+        this->tree_q_cycle_.q = this->tree_q_;
+        this->tree_q_cycle_.qdot = this->tree_q_dot_;
     }
 
+    // Frames of all links of the robot in one pass: consistent poses for links of interest and self-collision links.
+    this->tree_fk_solver_->JntToCart(this->tree_q_cycle_);
+    this->work_cb_tree_root_ = this->tree_fk_solver_->getFrameVelAtSegment(this->chain_base_idx_).Inverse();
+    if (this->root_frame_idx_ >= 0)
+    {
+        KDL::Frame cb_root = this->work_cb_tree_root_.GetFrame() *
+                             this->tree_fk_solver_->getFrameVelAtSegment(this->root_frame_idx_).GetFrame();
+        tf::transformKDLToEigen(cb_root, this->work_tf_cb_frame_bl_);
+    }
+    else
+    {
+        this->work_tf_cb_frame_bl_ = this->getSynchedCbToBlTransform();
+    }
+
+    this->work_items_.clear();
     for (ShapesManager::MapIter_t it = this->object_of_interest_mgr_->begin(); it != this->object_of_interest_mgr_->end(); ++it)
     {
-        std::string object_of_interest_name = it->first;
-        std::vector<std::string>::const_iterator str_it = std::find(this->segments_.begin(),
-                                                                    this->segments_.end(),
-                                                                    object_of_interest_name);
-        if (this->segments_.end() == str_it)
+        const int idx = this->tree_fk_solver_->getSegmentIndex(it->first);
+        if (idx < 0)
         {
-            ROS_ERROR_STREAM("Could not find: " << object_of_interest_name << ". Skipping it ...");
+            ROS_ERROR_STREAM("Could not find: " << it->first << ". Skipping it ...");
             continue;
         }
 
-        // Representation of segment_of_interest as specific shape
-        PtrIMarkerShape_t ooi = it->second;
-        uint16_t idx = str_it - this->segments_.begin();
-        geometry_msgs::Pose origin_p = ooi->getOriginRelToFrame();
-        KDL::Frame origin_f;
-        tf::poseMsgToKDL(origin_p, origin_f);
-
-        // ******* Start Transformation part **************
-        KDL::FrameVel frame_vel = adv_chn_fk_solver_vel_->getFrameVelAtSegment(idx);
-        KDL::Frame frame_pos = frame_vel.GetFrame();
-        KDL::Frame frame_with_offset = frame_pos * origin_f;
-
-        Eigen::Vector3d chainbase2frame_pos(frame_with_offset.p.x(),
-                                            frame_with_offset.p.y(),
-                                            frame_with_offset.p.z());
-
-        Eigen::Affine3d tmp_tf_cb_frame_bl = this->getSynchedCbToBlTransform();
-        Eigen::Affine3d tmp_inv_tf_cb_frame_bl = tmp_tf_cb_frame_bl.inverse();
-        Eigen::Vector3d abs_jnt_pos = tmp_inv_tf_cb_frame_bl * chainbase2frame_pos;
-
-        Eigen::Quaterniond q;
-        tf::quaternionKDLToEigen(frame_with_offset.M, q);
-        Eigen::Matrix3d x = (tmp_inv_tf_cb_frame_bl * q).rotation();
-        Eigen::Quaterniond q_1(x);
-        // ******* End Transformation part **************
-
-        geometry_msgs::Vector3 v3;
-        geometry_msgs::Quaternion quat;
-        tf::quaternionEigenToMsg(q_1, quat);
-        tf::vectorEigenToMsg(abs_jnt_pos, v3);
-        ooi->updatePose(v3, quat);
-
-        fcl::CollisionObject ooi_co = ooi->getCollisionObject();
-        fcl::FCL_REAL last_dist = std::numeric_limits<fcl::FCL_REAL>::max();
-        {  // introduced the block to lock this critical section until block leaved.
-            std::lock_guard<std::mutex> lock(obstacle_mgr_mtx_);
-            for (ShapesManager::MapIter_t it = this->obstacle_mgr_->begin(); it != this->obstacle_mgr_->end(); ++it)
-            {
-                const std::string obstacle_id = it->first;
-                if (this->link_to_collision_.ignoreSelfCollisionPart(object_of_interest_name, obstacle_id))
-                {
-                    // Ignore elements that can never be in collision
-                    // (specified in parameter and parent / child frames)
-                    continue;
-                }
+        WorkItem item;
+        item.name_ = it->first;
+        item.ooi_ = it->second;
+        item.segment_idx_ = static_cast<uint32_t>(idx);
+        item.pair_cache_ = NULL;  // resolved under obstacle_mgr_mtx_ below
+        this->work_items_.push_back(item);
+    }
+
+    this->work_results_.assign(this->work_items_.size(), WorkResult());
 
-                PtrIMarkerShape_t obstacle = it->second;
-                fcl::CollisionObject collision_obj = obstacle->getCollisionObject();
-                fcl::DistanceResult dist_result;
-                fcl::DistanceRequest dist_request(true, 5.0, 0.01);
-                fcl::FCL_REAL dist = fcl::distance(&ooi_co, &collision_obj, dist_request, dist_result);
+    {  // obstacles must not change while the workers are running
+        std::lock_guard<std::mutex> lock(obstacle_mgr_mtx_);
 
+        // the outer map is created here, under the same lock as removeFromPairCache, so that workers never modify it
+        for (std::vector<WorkItem>::iterator it = this->work_items_.begin(); it != this->work_items_.end(); ++it)
+        {
+            it->pair_cache_ = &this->pair_cache_[it->name_];
+        }
 
-                Eigen::Vector3d abs_obst_vector(dist_result.nearest_points[1][VEC_X],
-                                                dist_result.nearest_points[1][VEC_Y],
-                                                dist_result.nearest_points[1][VEC_Z]);
-                Eigen::Vector3d obst_vector = tmp_tf_cb_frame_bl * abs_obst_vector;
+        this->updateSelfCollisionPoses(this->work_tf_cb_frame_bl_);
+        this->obstacle_mgr_->updateBroadphase();
+        if (this->static_field_)
+        {
+            this->static_field_->update();
+        }
 
-                Eigen::Vector3d abs_jnt_pos_update(dist_result.nearest_points[0][VEC_X],
-                                                   dist_result.nearest_points[0][VEC_Y],
-                                                   dist_result.nearest_points[0][VEC_Z]);
+        if (this->point_cloud_obstacles_)
+        {
+            this->cloud_snapshot_ = this->point_cloud_obstacles_->getSnapshot();
+            this->cloud_time_ = ros::Time::now();
+        }
 
-                // vector from arm base link frame to nearest collision point on frame
-                Eigen::Vector3d rel_base_link_frame_pos = tmp_tf_cb_frame_bl * abs_jnt_pos_update;
-                ROS_DEBUG_STREAM("Link \"" << object_of_interest_name << "\": Minimal distance: " << dist_result.min_distance);
-                if (dist_result.min_distance < MIN_DISTANCE)
-                {
-                    cob_control_msgs::ObstacleDistance od_msg;
-                    od_msg.distance = dist_result.min_distance;
-                    od_msg.link_of_interest = object_of_interest_name;
-                    od_msg.obstacle_id = obstacle_id;
-                    od_msg.header.frame_id = chain_base_link_;
-                    od_msg.header.stamp = ros::Time::now();
-                    od_msg.header.seq = seq_nr_;
-                    tf::vectorEigenToMsg(obst_vector, od_msg.nearest_point_obstacle_vector);
-                    tf::vectorEigenToMsg(rel_base_link_frame_pos, od_msg.nearest_point_frame_vector);
-                    tf::vectorEigenToMsg(chainbase2frame_pos, od_msg.frame_vector);
-                    obstacle_distances.distances.push_back(od_msg);
-                }
+        if (this->workers_.size() > 0 && this->work_items_.size() > 1)
+        {
+            {
+                std::lock_guard<std::mutex> work_lock(work_mtx_);
+                this->pending_workers_ = static_cast<uint16_t>(this->workers_.size());
+                ++this->work_cycle_;
+            }
+
+            this->work_cv_.notify_all();
+            this->processWorkItems(0);
+
+            std::unique_lock<std::mutex> work_lock(work_mtx_);
+            this->done_cv_.wait(work_lock, [this] { return 0 == this->pending_workers_; });
+        }
+        else
+        {
+            for (uint32_t i = 0; i < this->work_items_.size(); ++i)
+            {
+                this->calculateLink(this->work_items_[i], this->work_results_[i]);
             }
         }
     }
 
-    if (obstacle_distances.distances.size() > 0)
+    for (std::vector<WorkResult>::iterator it = this->work_results_.begin(); it != this->work_results_.end(); ++it)
+    {
+        if (this->closest_obstacles_per_link_ > 0 && it->distances_.size() > this->closest_obstacles_per_link_)
+        {
+            std::nth_element(it->distances_.begin(),
+                             it->distances_.begin() + this->closest_obstacles_per_link_,
+                             it->distances_.end(),
+                             [](const cob_control_msgs::ObstacleDistance& a, const cob_control_msgs::ObstacleDistance& b)
+                             { return a.distance < b.distance; });
+            it->distances_.resize(this->closest_obstacles_per_link_);
+        }
+
+        obstacle_distances.distances.insert(obstacle_distances.distances.end(), it->distances_.begin(), it->distances_.end());
+        num_pairs += it->num_pairs_;
+        num_queries += it->num_queries_;
+        num_reused += it->num_reused_;
+        num_skipped += it->num_skipped_;
+        num_coarse += it->num_coarse_;
+        num_field += it->num_field_;
+        num_cloud_points += it->num_cloud_points_;
+    }
+
+    ROS_DEBUG_STREAM("DistanceManager::calculate: " << num_queries << " narrow-phase queries, " << num_coarse <<
+                     " coarse, " << num_reused << " cached and " << num_skipped << " bounded results for " << num_pairs <<
+                     " link/obstacle pairs, " << num_field << " distance field lookups and " << num_cloud_points <<
+                     " point cloud voxels in " <<
+                     (ros::WallTime::now() - start_time).toSec() * 1000.0 << " ms.");
+
+    if (this->compact_encoder_)
+    {
+        cob_control_msgs::ObstacleDistanceNames names;
+        cob_control_msgs::CompactObstacleDistances compact;
+        if (this->compact_encoder_->encode(obstacle_distances.distances, compact))
+        {
+            compact.header.frame_id = chain_base_link_;
+            compact.header.stamp = ros::Time::now();
+            if (this->compact_encoder_->getChangedNames(names))
+            {
+                // new names are published ahead of the distances that refer to them
+                names.header.stamp = compact.header.stamp;
+                this->distance_names_pub_.publish(names);
+            }
+
+            this->compact_distances_pub_.publish(compact);
+        }
+    }
+    else if (obstacle_distances.distances.size() > 0)
     {
         this->obstacle_distances_pub_.publish(obstacle_distances);
     }
 }
 
 
-void DistanceManager::transform()
+void DistanceManager::updateSelfCollisionPoses(const Eigen::Affine3d& tf_cb_frame_bl)
 {
-    while (!this->stop_sca_threads_)
+    if (this->self_collision_links_.empty())
     {
-        try
+        return;
+    }
+
+    KDL::Frame root_frame_cb;
+    tf::transformEigenToKDL(tf_cb_frame_bl.inverse(), root_frame_cb);
+
+    // root frame <- tree root, for all self-collision links of this cycle
+    const KDL::Frame root_frame_tree_root = root_frame_cb * this->work_cb_tree_root_.GetFrame();
+    for (uint32_t i = 0; i < this->self_collision_links_.size(); ++i)
+    {
+        PtrIMarkerShape_t shape_ptr;
+        if (!this->obstacle_mgr_->getShape(this->self_collision_links_[i], shape_ptr))
         {
-            tf::StampedTransform cb_transform_bl;
-            ros::Time time = ros::Time(0);
-            if (tf_listener_.waitForTransform(chain_base_link_, root_frame_id_, time, ros::Duration(5.0)))
+            continue;
+        }
+
+        KDL::Frame origin_f;
+        geometry_msgs::Pose updated_pose;
+        tf::poseMsgToKDL(shape_ptr->getOriginRelToFrame(), origin_f);
+        const KDL::Frame& tree_root_link = this->tree_fk_solver_->getFrameVelAtSegment(this->self_collision_idx_[i]).GetFrame();
+        tf::poseKDLToMsg(root_frame_tree_root * tree_root_link * origin_f, updated_pose);
+        shape_ptr->updatePose(updated_pose);
+    }
+}
+
+
+void DistanceManager::calculateWorker(uint16_t worker_idx)
+{
+    uint32_t last_cycle = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(work_mtx_);
+            this->work_cv_.wait(lock, [this, last_cycle] { return this->stop_workers_ || this->work_cycle_ != last_cycle; });
+            if (this->stop_workers_)
             {
-                std::lock_guard<std::mutex> lock(mtx_);
-                tf_listener_.lookupTransform(chain_base_link_, root_frame_id_, time, cb_transform_bl);
-                tf::transformTFToEigen(cb_transform_bl, tf_cb_frame_bl_);
+                return;
             }
+
+            last_cycle = this->work_cycle_;
         }
-        catch (tf::TransformException& ex)
+
+        this->processWorkItems(worker_idx);
+
         {
-            ROS_ERROR("%s", ex.what());
+            std::lock_guard<std::mutex> lock(work_mtx_);
+            --this->pending_workers_;
         }
 
-        ros::Duration(0.1).sleep();
+        this->done_cv_.notify_one();
     }
 }
 
 
-void DistanceManager::transformSelfCollisionLinks(const std::string link_name)
+void DistanceManager::processWorkItems(uint16_t worker_idx)
 {
-    ROS_INFO_STREAM("Starting transform_listener thread for link name: " << link_name);
-    while (!this->stop_sca_threads_)
+    for (uint32_t i = worker_idx; i < this->work_items_.size(); i += this->num_workers_)
     {
-        try
+        this->calculateLink(this->work_items_[i], this->work_results_[i]);
+    }
+}
+
+
+void DistanceManager::calculateLink(const WorkItem& item, WorkResult& result)
+{
+    const std::string& object_of_interest_name = item.name_;
+    std::vector<std::string> candidates;
+
+    // Representation of segment_of_interest as specific shape
+    PtrIMarkerShape_t ooi = item.ooi_;
+    geometry_msgs::Pose origin_p = ooi->getOriginRelToFrame();
+    KDL::Frame origin_f;
+    tf::poseMsgToKDL(origin_p, origin_f);
+
+    // ******* Start Transformation part **************
+    KDL::FrameVel frame_vel = this->work_cb_tree_root_ * this->tree_fk_solver_->getFrameVelAtSegment(item.segment_idx_);
+    KDL::Frame frame_pos = frame_vel.GetFrame();
+    KDL::Frame frame_with_offset = frame_pos * origin_f;
+
+    Eigen::Vector3d chainbase2frame_pos(frame_with_offset.p.x(),
+                                        frame_with_offset.p.y(),
+                                        frame_with_offset.p.z());
+
+    const Eigen::Affine3d& tmp_tf_cb_frame_bl = this->work_tf_cb_frame_bl_;
+    Eigen::Affine3d tmp_inv_tf_cb_frame_bl = tmp_tf_cb_frame_bl.inverse();
+    Eigen::Vector3d abs_jnt_pos = tmp_inv_tf_cb_frame_bl * chainbase2frame_pos;
+
+    Eigen::Quaterniond q;
+    tf::quaternionKDLToEigen(frame_with_offset.M, q);
+    Eigen::Matrix3d x = (tmp_inv_tf_cb_frame_bl * q).rotation();
+    Eigen::Quaterniond q_1(x);
+    // ******* End Transformation part **************
+
+    geometry_msgs::Vector3 v3;
+    geometry_msgs::Quaternion quat;
+    tf::quaternionEigenToMsg(q_1, quat);
+    tf::vectorEigenToMsg(abs_jnt_pos, v3);
+    ooi->updatePose(v3, quat);
+
+    const fcl::CollisionObject& ooi_co = ooi->getCollisionObject();
+    result.num_pairs_ = this->obstacle_mgr_->count();
+
+    // velocity of the origin of the collision object in the root frame, for the time to contact
+    KDL::Twist twist_root = KDL::Twist::Zero();
+    if (this->continuous_horizon_ > 0.0)
+    {
+        KDL::Twist twist_cb = frame_vel.GetTwist();
+        twist_cb.vel = twist_cb.vel + twist_cb.rot * (frame_with_offset.p - frame_pos.p);
+        KDL::Frame root_frame_cb;
+        tf::transformEigenToKDL(tmp_inv_tf_cb_frame_bl, root_frame_cb);
+        twist_root = root_frame_cb.M * twist_cb;
+    }
+
+    // Broad-phase: only obstacles with an AABB closer than MIN_DISTANCE can produce a distance to be published.
+    this->obstacle_mgr_->getCandidates(ooi_co.getAABB(), MIN_DISTANCE, candidates);
+    for (std::vector<std::string>::const_iterator it = candidates.begin(); it != candidates.end(); ++it)
+    {
+        const std::string obstacle_id = *it;
+        if (this->link_to_collision_.ignoreSelfCollisionPart(object_of_interest_name, obstacle_id))
         {
-            ros::Time time = ros::Time(0);
-            // https://github.com/ros-visualization/rviz/issues/702: TF listener is thread safe
-            if (tf_listener_.waitForTransform(root_frame_id_, link_name, time, ros::Duration(5.0)))
+            // Ignore elements that can never be in collision
+            // (specified in parameter and parent / child frames)
+            continue;
+        }
+
+        if (this->static_field_ && this->static_field_->contains(obstacle_id) &&
+            this->calculateStaticField(item, obstacle_id, ooi_co, chainbase2frame_pos, result))
+        {
+            continue;  // answered by the distance field
+        }
+
+        PtrIMarkerShape_t obstacle;
+        if (!this->obstacle_mgr_->getShape(obstacle_id, obstacle))
+        {
+            continue;
+        }
+
+        const fcl::CollisionObject* collision_obj = &obstacle->getCollisionObject();
+        PairCacheEntry& cache_entry = (*item.pair_cache_)[obstacle_id];
+        double motion = std::numeric_limits<double>::max();
+        if (cache_entry.obstacle_ == collision_obj)
+        {
+            motion = motionBound(ooi_co, cache_entry.link_transform_) +
+                     motionBound(*collision_obj, cache_entry.obstacle_transform_);
+        }
+
+        if (motion < std::numeric_limits<double>::max() &&
+            cache_entry.distance_ - motion > MIN_DISTANCE)
+        {
+            // Lipschitz bound: the pair cannot have come closer than MIN_DISTANCE.
+            ++result.num_skipped_;
+            continue;
+        }
+
+        if (motion > this->cache_tolerance_ || !cache_entry.exact_)
+        {
+            cache_entry.obstacle_ = collision_obj;
+            cache_entry.link_transform_ = ooi_co.getTransform();
+            cache_entry.obstacle_transform_ = collision_obj->getTransform();
+
+            // Coarse stage: the sphere proxies give a lower bound, refine with the full geometry only if it is close enough.
+            if (NULL != ooi->getProxy() && NULL != obstacle->getProxy())
             {
-                std::lock_guard<std::mutex> lock(obstacle_mgr_mtx_);
-                tf::StampedTransform stamped_transform;
-                geometry_msgs::Transform msg_transform;
-                tf_listener_.lookupTransform(root_frame_id_, link_name, time, stamped_transform);
-                PtrIMarkerShape_t shape_ptr;
-                if (this->obstacle_mgr_->getShape(link_name, shape_ptr))
+                const double coarse_distance = ooi->getProxy()->distance(ooi_co.getTransform(),
+                                                                         *obstacle->getProxy(),
+                                                                         collision_obj->getTransform(),
+                                                                         this->lod_activation_distance_);
+                if (coarse_distance > this->lod_activation_distance_)
                 {
-                    geometry_msgs::Pose origin_p = shape_ptr->getOriginRelToFrame();
-                    tf::Transform tf_origin_pose;
-                    tf::poseMsgToTF(origin_p, tf_origin_pose);
-                    tf::Transform updated_pose = tf::Transform(stamped_transform) * tf_origin_pose;
-                    tf::transformTFToMsg(updated_pose, msg_transform);
-                    shape_ptr->updatePose(msg_transform.translation, msg_transform.rotation);
+                    cache_entry.distance_ = coarse_distance;
+                    cache_entry.exact_ = false;
+                    ++result.num_coarse_;
+                    continue;
                 }
             }
+
+            fcl::DistanceResult dist_result;
+            fcl::DistanceRequest dist_request(true, 5.0, 0.01);
+            fcl::distance(&ooi_co, collision_obj, dist_request, dist_result);
+            ++result.num_queries_;
+
+            cache_entry.distance_ = dist_result.min_distance;
+            cache_entry.exact_ = true;
+            cache_entry.nearest_points_[0] = dist_result.nearest_points[0];
+            cache_entry.nearest_points_[1] = dist_result.nearest_points[1];
         }
-        catch (tf::TransformException& ex)
+        else
         {
-            ROS_ERROR("%s", ex.what());
+            // Neither side moved more than the tolerance: reuse the last result.
+            ++result.num_reused_;
         }
 
-        ros::Duration(0.1).sleep();
+        fcl::DistanceResult dist_result;
+        dist_result.min_distance = cache_entry.distance_;
+        dist_result.nearest_points[0] = cache_entry.nearest_points_[0];
+        dist_result.nearest_points[1] = cache_entry.nearest_points_[1];
+
+        Eigen::Vector3d abs_obst_vector(dist_result.nearest_points[1][VEC_X],
+                                        dist_result.nearest_points[1][VEC_Y],
+                                        dist_result.nearest_points[1][VEC_Z]);
+        Eigen::Vector3d obst_vector = tmp_tf_cb_frame_bl * abs_obst_vector;
+
+        Eigen::Vector3d abs_jnt_pos_update(dist_result.nearest_points[0][VEC_X],
+                                           dist_result.nearest_points[0][VEC_Y],
+                                           dist_result.nearest_points[0][VEC_Z]);
+
+        // vector from arm base link frame to nearest collision point on frame
+        Eigen::Vector3d rel_base_link_frame_pos = tmp_tf_cb_frame_bl * abs_jnt_pos_update;
+        ROS_DEBUG_STREAM("Link \"" << object_of_interest_name << "\": Minimal distance: " << dist_result.min_distance);
+        if (dist_result.min_distance < MIN_DISTANCE)
+        {
+            cob_control_msgs::ObstacleDistance od_msg;
+            od_msg.distance = dist_result.min_distance;
+            od_msg.link_of_interest = object_of_interest_name;
+            od_msg.obstacle_id = obstacle_id;
+            od_msg.header.frame_id = chain_base_link_;
+            od_msg.header.stamp = ros::Time::now();
+            od_msg.header.seq = seq_nr_;
+            tf::vectorEigenToMsg(obst_vector, od_msg.nearest_point_obstacle_vector);
+            tf::vectorEigenToMsg(rel_base_link_frame_pos, od_msg.nearest_point_frame_vector);
+            tf::vectorEigenToMsg(chainbase2frame_pos, od_msg.frame_vector);
+            od_msg.time_to_contact = this->continuous_horizon_ > 0.0 ?
+                                     this->timeToContact(ooi_co, twist_root, *collision_obj, dist_result.min_distance) : -1.0;
+            od_msg.contact_predicted = od_msg.time_to_contact >= 0.0;
+            result.distances_.push_back(od_msg);
+        }
+    }
+
+    if (this->cloud_snapshot_ && !this->cloud_snapshot_->points_.empty())
+    {
+        this->calculatePointCloud(item, ooi_co, chainbase2frame_pos, result);
     }
 }
 
 
-void DistanceManager::jointstateCb(const sensor_msgs::JointState::ConstPtr& msg)
+void DistanceManager::calculatePointCloud(const WorkItem& item,
+                                          const fcl::CollisionObject& ooi_co,
+                                          const Eigen::Vector3d& chainbase2frame_pos,
+                                          WorkResult& result)
 {
-    KDL::JntArray q_temp = last_q_;
-    KDL::JntArray q_dot_temp = last_q_dot_;
-    uint16_t count = 0;
+    const PointCloudObstacles::Snapshot& cloud = *this->cloud_snapshot_;
+    fcl::AABB box(ooi_co.getAABB());
+    box.expand(fcl::Vec3f(MIN_DISTANCE, MIN_DISTANCE, MIN_DISTANCE));
+
+    std::vector<uint32_t> indices;
+    cloud.getPointsWithin(box, this->cloud_time_, indices);
+    result.num_cloud_points_ += indices.size();
+    if (indices.empty())
+    {
+        return;
+    }
+
+    // the spheres enclose the link: their distance to a voxel center is a lower bound
+    std::vector<SphereProxy::Sphere> spheres;
+    const fcl::Transform3f& tf = ooi_co.getTransform();
+    if (NULL != item.ooi_->getProxy())
+    {
+        spheres = item.ooi_->getProxy()->getSpheres();
+    }
+    else
+    {
+        SphereProxy::Sphere bounding;
+        bounding.center_ = ooi_co.collisionGeometry()->aabb_center;
+        bounding.radius_ = ooi_co.collisionGeometry()->aabb_radius;
+        spheres.push_back(bounding);
+    }
+
+    for (std::vector<SphereProxy::Sphere>::iterator it = spheres.begin(); it != spheres.end(); ++it)
+    {
+        it->center_ = tf.transform(it->center_);
+    }
 
-    for (uint16_t j = 0; j < chain_.getNrOfJoints(); j++)
+    const double voxel_radius = 0.5 * std::sqrt(3.0) * cloud.voxel_size_;
+    std::vector<std::pair<double, uint32_t> > candidates;
+    for (std::vector<uint32_t>::const_iterator it = indices.begin(); it != indices.end(); ++it)
     {
-        for (uint16_t i = 0; i < msg->name.size(); i++)
+        double lower_bound = std::numeric_limits<double>::max();
+        for (std::vector<SphereProxy::Sphere>::const_iterator s = spheres.begin(); s != spheres.end(); ++s)
         {
-            if (strcmp(msg->name[i].c_str(), joints_[j].c_str()) == 0)
-            {
-                q_temp(j) = msg->position[i];
-                q_dot_temp(j) = msg->velocity[i];
-                count++;
-                break;
-            }
+            lower_bound = std::min(lower_bound, (cloud.points_[*it] - s->center_).length() - s->radius_ - voxel_radius);
+        }
+
+        if (lower_bound < MIN_DISTANCE)
+        {
+            candidates.push_back(std::make_pair(lower_bound, *it));
         }
     }
 
-    if (joints_.size() == count)
+    if (candidates.empty())
     {
-        last_q_ = q_temp;
-        last_q_dot_ = q_dot_temp;
+        return;
     }
-    else
+
+    const size_t num_refine = std::min(candidates.size(), static_cast<size_t>(POINT_CLOUD_REFINE_CANDIDATES));
+    std::partial_sort(candidates.begin(), candidates.begin() + num_refine, candidates.end());
+
+    // exact distance between the link and the closest voxels (as spheres around the voxel centers)
+    std::shared_ptr<fcl::Sphere> voxel_geometry(new fcl::Sphere(0.5 * cloud.voxel_size_));
+    fcl::DistanceResult best;
+    best.min_distance = std::numeric_limits<double>::max();
+    for (size_t i = 0; i < num_refine; ++i)
     {
-        ROS_ERROR("jointstateCb: received unexpected 'joint_states'");
+        fcl::CollisionObject voxel(voxel_geometry, fcl::Transform3f(cloud.points_[candidates[i].second]));
+        fcl::DistanceResult dist_result;
+        fcl::DistanceRequest dist_request(true, 5.0, 0.01);
+        fcl::distance(&ooi_co, &voxel, dist_request, dist_result);
+        if (dist_result.min_distance < best.min_distance)
+        {
+            best = dist_result;
+        }
     }
+
+    if (best.min_distance >= MIN_DISTANCE)
+    {
+        return;
+    }
+
+    const Eigen::Affine3d& tf_cb_frame_bl = this->work_tf_cb_frame_bl_;
+    Eigen::Vector3d obst_vector = tf_cb_frame_bl * Eigen::Vector3d(best.nearest_points[1][VEC_X],
+                                                                   best.nearest_points[1][VEC_Y],
+                                                                   best.nearest_points[1][VEC_Z]);
+    Eigen::Vector3d rel_base_link_frame_pos = tf_cb_frame_bl * Eigen::Vector3d(best.nearest_points[0][VEC_X],
+                                                                               best.nearest_points[0][VEC_Y],
+                                                                               best.nearest_points[0][VEC_Z]);
+
+    cob_control_msgs::ObstacleDistance od_msg;
+    od_msg.distance = best.min_distance;
+    od_msg.link_of_interest = item.name_;
+    od_msg.obstacle_id = POINT_CLOUD_OBSTACLE_ID;
+    od_msg.header.frame_id = chain_base_link_;
+    od_msg.header.stamp = ros::Time::now();
+    od_msg.header.seq = seq_nr_;
+    tf::vectorEigenToMsg(obst_vector, od_msg.nearest_point_obstacle_vector);
+    tf::vectorEigenToMsg(rel_base_link_frame_pos, od_msg.nearest_point_frame_vector);
+    tf::vectorEigenToMsg(chainbase2frame_pos, od_msg.frame_vector);
+    od_msg.contact_predicted = false;  // not predicted for point cloud voxels
+    od_msg.time_to_contact = -1.0;
+    result.distances_.push_back(od_msg);
 }
 
 
-void DistanceManager::registerObstacle(const moveit_msgs::CollisionObject::ConstPtr& msg)
+bool DistanceManager::calculateStaticField(const WorkItem& item,
+                                           const std::string& obstacle_id,
+                                           const fcl::CollisionObject& ooi_co,
+                                           const Eigen::Vector3d& chainbase2frame_pos,
+                                           WorkResult& result)
 {
-    std::lock_guard<std::mutex> lock(obstacle_mgr_mtx_);
+    const SphereProxy* proxy = item.ooi_->getProxy();
+    if (NULL == proxy)
+    {
+        return false;
+    }
 
-    const std::string frame_id = msg->header.frame_id;
-    tf::StampedTransform frame_transform_root;
-    Eigen::Affine3d tf_frame_root;
+    // closest proxy sphere to the obstacle
+    double min_distance = std::numeric_limits<double>::max();
+    double uncovered_bound = std::numeric_limits<double>::max();
+    fcl::Vec3f min_center, min_gradient;
+    double min_center_distance = 0.0, min_radius = 0.0;
+    const fcl::Transform3f& tf = ooi_co.getTransform();
+    const std::vector<SphereProxy::Sphere>& spheres = proxy->getSpheres();
+    for (std::vector<SphereProxy::Sphere>::const_iterator it = spheres.begin(); it != spheres.end(); ++it)
+    {
+        double center_distance;
+        fcl::Vec3f gradient;
+        const fcl::Vec3f center = tf.transform(it->center_);
+        ++result.num_field_;
+        if (!this->static_field_->query(obstacle_id, center, center_distance, gradient))
+        {
+            // the center is farther than the margin from the obstacle
+            uncovered_bound = std::min(uncovered_bound, this->static_field_->getMargin() - it->radius_);
+            continue;
+        }
+
+        const double distance = center_distance - it->radius_;
+        if (distance < min_distance)
+        {
+            min_distance = distance;
+            min_center = center;
+            min_gradient = gradient;
+            min_center_distance = center_distance;
+            min_radius = it->radius_;
+        }
+    }
 
-    if (msg->meshes.size() > 0 && msg->primitives.size() > 0)
+    if (uncovered_bound < std::min(min_distance, MIN_DISTANCE))
     {
-        ROS_ERROR_STREAM("registerObstacle: Can either build mesh or primitive but not both in one message for one id.");
-        return;
+        return false;  // a sphere larger than the error bound might be closer than the grid can tell: narrow phase
+    }
+
+    if (min_distance >= MIN_DISTANCE)
+    {
+        return true;
+    }
+
+    // the gradient points away from the obstacle
+    const double gradient_norm = min_gradient.length();
+    const fcl::Vec3f direction = gradient_norm > 0.0 ? min_gradient / gradient_norm : fcl::Vec3f(0.0, 0.0, 1.0);
+    const fcl::Vec3f frame_point = min_center - direction * min_radius;
+    const fcl::Vec3f obstacle_point = min_center - direction * min_center_distance;
+
+    const Eigen::Affine3d& tf_cb_frame_bl = this->work_tf_cb_frame_bl_;
+    Eigen::Vector3d rel_base_link_frame_pos = tf_cb_frame_bl * Eigen::Vector3d(frame_point[VEC_X], frame_point[VEC_Y], frame_point[VEC_Z]);
+    Eigen::Vector3d obst_vector = tf_cb_frame_bl * Eigen::Vector3d(obstacle_point[VEC_X], obstacle_point[VEC_Y], obstacle_point[VEC_Z]);
+
+    cob_control_msgs::ObstacleDistance od_msg;
+    od_msg.distance = min_distance;
+    od_msg.link_of_interest = item.name_;
+    od_msg.obstacle_id = obstacle_id;
+    od_msg.header.frame_id = chain_base_link_;
+    od_msg.header.stamp = ros::Time::now();
+    od_msg.header.seq = seq_nr_;
+    tf::vectorEigenToMsg(obst_vector, od_msg.nearest_point_obstacle_vector);
+    tf::vectorEigenToMsg(rel_base_link_frame_pos, od_msg.nearest_point_frame_vector);
+    tf::vectorEigenToMsg(chainbase2frame_pos, od_msg.frame_vector);
+    od_msg.contact_predicted = false;  // not predicted for lookups in the distance field
+    od_msg.time_to_contact = -1.0;
+    result.distances_.push_back(od_msg);
+    return true;
+}
+
+
+double DistanceManager::timeToContact(const fcl::CollisionObject& ooi_co,
+                                      const KDL::Twist& twist,
+                                      const fcl::CollisionObject& obstacle,
+                                      double distance) const
+{
+    // all points of the link geometry lie within the bounding sphere around the local frame origin
+    const fcl::CollisionGeometry* geometry = ooi_co.collisionGeometry().get();
+    const double radius = geometry->aabb_center.length() + geometry->aabb_radius;
+    const double speed = twist.vel.Norm() + twist.rot.Norm() * radius;
+    if (distance <= CONTINUOUS_CONTACT_DISTANCE)
+    {
+        return 0.0;
+    }
+
+    if (speed * this->continuous_horizon_ < distance)
+    {
+        return -1.0;  // cannot reach the obstacle within the horizon
+    }
+
+    const fcl::Transform3f& tf_start = ooi_co.getTransform();
+    const fcl::Matrix3f& r = tf_start.getRotation();
+    const fcl::Vec3f& p = tf_start.getTranslation();
+    const KDL::Frame start(KDL::Rotation(r(0, 0), r(0, 1), r(0, 2),
+                                         r(1, 0), r(1, 1), r(1, 2),
+                                         r(2, 0), r(2, 1), r(2, 2)),
+                           KDL::Vector(p[VEC_X], p[VEC_Y], p[VEC_Z]));
+
+    double time = 0.0;
+    for (uint32_t i = 0; i < CONTINUOUS_MAX_ITERATIONS; ++i)
+    {
+        time += distance / speed;
+        if (time > this->continuous_horizon_)
+        {
+            return -1.0;
+        }
+
+        const KDL::Frame moved = KDL::addDelta(start, twist, time);
+        const fcl::Transform3f tf_moved(fcl::Matrix3f(moved.M(0, 0), moved.M(0, 1), moved.M(0, 2),
+                                                      moved.M(1, 0), moved.M(1, 1), moved.M(1, 2),
+                                                      moved.M(2, 0), moved.M(2, 1), moved.M(2, 2)),
+                                        fcl::Vec3f(moved.p.x(), moved.p.y(), moved.p.z()));
+        fcl::DistanceRequest request(false);
+        fcl::DistanceResult result;
+        fcl::distance(geometry, tf_moved, obstacle.collisionGeometry().get(), obstacle.getTransform(), request, result);
+        distance = result.min_distance;
+        if (distance <= CONTINUOUS_CONTACT_DISTANCE)
+        {
+            return time;
+        }
+    }
+
+    return -1.0;  // not converged: the link only grazes the obstacle, no contact is predicted
+}
+
+
+void DistanceManager::stopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(work_mtx_);
+        this->stop_workers_ = true;
+    }
+
+    this->work_cv_.notify_all();
+    for (std::vector<std::thread>::iterator it = this->workers_.begin(); it != this->workers_.end(); ++it)
+    {
+        it->join();
+    }
+
+    this->workers_.clear();
+}
+
+
+void DistanceManager::transform()
+{
+    if (this->root_frame_idx_ >= 0)
+    {
+        return;  // chain base and root frame are links of the robot: computed by tree FK in each cycle
     }
 
-    if (msg->operation == msg->ADD && this->obstacle_mgr_->count(msg->id) > 0)
+    while (!this->stop_sca_threads_)
+    {
+        try
+        {
+            tf::StampedTransform cb_transform_bl;
+            ros::Time time = ros::Time(0);
+            if (tf_listener_.waitForTransform(chain_base_link_, root_frame_id_, time, ros::Duration(5.0)))
+            {
+                std::lock_guard<std::mutex> lock(mtx_);
+                tf_listener_.lookupTransform(chain_base_link_, root_frame_id_, time, cb_transform_bl);
+                tf::transformTFToEigen(cb_transform_bl, tf_cb_frame_bl_);
+            }
+        }
+        catch (tf::TransformException& ex)
+        {
+            ROS_ERROR("%s", ex.what());
+        }
+
+        ros::Duration(0.1).sleep();
+    }
+}
+
+
+void DistanceManager::jointstateCb(const sensor_msgs::JointState::ConstPtr& msg)
+{
+    // joints of the whole robot (may be published by several sources, each one updates the joints it knows)
+    std::lock_guard<std::mutex> lock(joint_state_mtx_);
+    for (uint16_t i = 0; i < msg->name.size() && i < msg->position.size(); i++)
+    {
+        std::unordered_map<std::string, unsigned int>::const_iterator it = this->tree_joint_idx_.find(msg->name[i]);
+        if (it != this->tree_joint_idx_.end())
+        {
+            this->tree_q_(it->second) = msg->position[i];
+            this->tree_q_dot_(it->second) = i < msg->velocity.size() ? msg->velocity[i] : 0.0;
+        }
+    }
+}
+
+
+void DistanceManager::pointcloudCb(const sensor_msgs::PointCloud2::ConstPtr& msg)
+{
+    if (!this->point_cloud_obstacles_)
     {
-        ROS_ERROR_STREAM("registerObstacle: Element " << msg->id << " exists already. ADD not allowed!");
         return;
     }
 
+    tf::StampedTransform root_from_cloud;
     try
     {
-        ros::Time time = ros::Time(0);
-        tf_listener_.waitForTransform(root_frame_id_, msg->header.frame_id, time, ros::Duration(0.5));
-        tf_listener_.lookupTransform(root_frame_id_, msg->header.frame_id, time, frame_transform_root);
-        tf::transformTFToEigen(frame_transform_root, tf_frame_root);
+        tf_listener_.waitForTransform(root_frame_id_, msg->header.frame_id, msg->header.stamp, ros::Duration(0.1));
+        tf_listener_.lookupTransform(root_frame_id_, msg->header.frame_id, msg->header.stamp, root_from_cloud);
     }
     catch (tf::TransformException& ex)
     {
@@ -434,169 +1092,363 @@ void DistanceManager::registerObstacle(const moveit_msgs::CollisionObject::Const
         return;
     }
 
-    if ((msg->type.db.length() > 0 && 0 < msg->mesh_poses.size()) ||
-       (msg->meshes.size() > 0 && msg->meshes.size() == msg->mesh_poses.size()))
+    this->point_cloud_obstacles_->insert(*msg, root_from_cloud);
+}
+
+
+void DistanceManager::registerObstacle(const moveit_msgs::CollisionObject::ConstPtr& msg)
+{
+    // waiting for tf must not block the distance calculation, hence look up before locking
+    FrameTransforms_t frame_transforms;
+    if (msg->REMOVE != msg->operation)
     {
-        this->buildObstacleMesh(msg, frame_transform_root);
+        this->lookupFrameTransform(msg->header.frame_id, frame_transforms);
     }
 
-    if (msg->primitives.size() > 0 && msg->primitives.size() == msg->primitive_poses.size())
+    std::lock_guard<std::mutex> lock(obstacle_mgr_mtx_);
+    if (this->applyCollisionObject(*msg, frame_transforms))
+    {
+        this->drawObstacles();
+    }
+}
+
+
+void DistanceManager::registerPlanningScene(const moveit_msgs::PlanningScene::ConstPtr& msg)
+{
+    // waiting for tf must not block the distance calculation, hence look up all frames before locking
+    FrameTransforms_t frame_transforms;
+    for (std::vector<moveit_msgs::CollisionObject>::const_iterator it = msg->world.collision_objects.begin();
+         it != msg->world.collision_objects.end();
+         ++it)
     {
-        this->buildObstaclePrimitive(msg, frame_transform_root);
+        if (it->REMOVE != it->operation && frame_transforms.count(it->header.frame_id) == 0)
+        {
+            this->lookupFrameTransform(it->header.frame_id, frame_transforms);
+        }
     }
 
+    std::lock_guard<std::mutex> lock(obstacle_mgr_mtx_);
+
+    if (!msg->is_diff)
+    {
+        // a complete scene replaces the registered obstacles, the self-collision links are part of the robot
+        std::vector<std::string> obsolete_ids;
+        for (ShapesManager::MapIter_t it = this->obstacle_mgr_->begin(); it != this->obstacle_mgr_->end(); ++it)
+        {
+            if (std::find(this->self_collision_links_.begin(), this->self_collision_links_.end(), it->first) == this->self_collision_links_.end())
+            {
+                obsolete_ids.push_back(it->first);
+            }
+        }
+
+        for (std::vector<std::string>::const_iterator it = obsolete_ids.begin(); it != obsolete_ids.end(); ++it)
+        {
+            this->removeObstacle(*it);
+        }
+    }
+
+    uint32_t num_applied = 0;
+    for (std::vector<moveit_msgs::CollisionObject>::const_iterator it = msg->world.collision_objects.begin();
+         it != msg->world.collision_objects.end();
+         ++it)
+    {
+        if (this->applyCollisionObject(*it, frame_transforms))
+        {
+            ++num_applied;
+        }
+    }
+
+    ROS_DEBUG_STREAM("registerPlanningScene: Applied " << num_applied << " of "
+                     << msg->world.collision_objects.size() << " collision objects.");
     this->drawObstacles();
 }
 
 
-void DistanceManager::buildObstacleMesh(const moveit_msgs::CollisionObject::ConstPtr& msg, const tf::StampedTransform& transform)
+bool DistanceManager::lookupFrameTransform(const std::string& frame_id, FrameTransforms_t& frame_transforms)
+{
+    tf::StampedTransform frame_transform_root;
+    try
+    {
+        ros::Time time = ros::Time(0);
+        tf_listener_.waitForTransform(root_frame_id_, frame_id, time, ros::Duration(0.5));
+        tf_listener_.lookupTransform(root_frame_id_, frame_id, time, frame_transform_root);
+    }
+    catch (tf::TransformException& ex)
+    {
+        ROS_ERROR("TransformException: %s", ex.what());
+        return false;
+    }
+
+    frame_transforms.insert(std::make_pair(frame_id, frame_transform_root));
+    return true;
+}
+
+
+bool DistanceManager::applyCollisionObject(const moveit_msgs::CollisionObject& msg, const FrameTransforms_t& frame_transforms)
 {
-    uint32_t m_size = msg->mesh_poses.size();
-    const std::string package_file_name = msg->type.db;  // using db field for package name instead of db json string
+    if (msg.REMOVE == msg.operation)
+    {
+        this->removeObstacle(msg.id);
+        return true;
+    }
 
-    if (msg->mesh_poses.size() > 1)
+    if (msg.ADD != msg.operation && msg.MOVE != msg.operation)
     {
-        ROS_WARN("Currenty only one mesh per message is supported! So only the first one is processed ...");
-        m_size = 1;
+        ROS_ERROR_STREAM("registerObstacle: Operation not supported for " << msg.id << "!");
+        return false;
     }
 
-    if (package_file_name.length() <= 0 && msg->mesh_poses.size() != msg->meshes.size())
+    if (msg.ADD == msg.operation && this->obstacle_mgr_->count(msg.id) > 0)
     {
-       ROS_ERROR("Mesh poses and meshes do not have the same size. If package resource string is empty then the sizes must be equal!");
-       return;
+        ROS_ERROR_STREAM("registerObstacle: Element " << msg.id << " exists already. ADD not allowed!");
+        return false;
     }
 
-    if (msg->ADD == msg->operation)
+    FrameTransforms_t::const_iterator tf_it = frame_transforms.find(msg.header.frame_id);
+    if (tf_it == frame_transforms.end())
     {
-        for (uint32_t i = 0; i < m_size; ++i)
+        ROS_ERROR_STREAM("registerObstacle: No transformation from " << msg.header.frame_id << " to " << root_frame_id_
+                         << " for element " << msg.id << "!");
+        return false;
+    }
+
+    const tf::StampedTransform& frame_transform_root = tf_it->second;
+    bool success = false;
+    if (msg.MOVE == msg.operation)
+    {
+        // the frame of an obstacle is the pose of its first part (first primitive, else first mesh)
+        PtrIMarkerShape_t sptr;
+        if (!this->obstacle_mgr_->getShape(msg.id, sptr))
+        {
+            ROS_ERROR_STREAM("registerObstacle: Element " << msg.id << " does not exist. MOVE not possible!");
+        }
+        else if (msg.primitive_poses.empty() && msg.mesh_poses.empty())
+        {
+            ROS_ERROR_STREAM("registerObstacle: No pose given to MOVE element " << msg.id << "!");
+        }
+        else
         {
-            geometry_msgs::Pose p = msg->mesh_poses[i];
+            geometry_msgs::Pose p = msg.primitive_poses.empty() ? msg.mesh_poses[0] : msg.primitive_poses[0];
             tf::Pose tf_p;
             tf::poseMsgToTF(p, tf_p);
-            tf::Pose new_tf_p = transform * tf_p;
+            tf::Pose new_tf_p = frame_transform_root * tf_p;
             tf::poseTFToMsg(new_tf_p, p);
-            PtrIMarkerShape_t sptr_Bvh;
-            if (package_file_name.length() > 0)
-            {
-                sptr_Bvh.reset(new MarkerShape<BVH_RSS_t>(this->root_frame_id_,
-                                                          package_file_name,
-                                                          p,
-                                                          g_shapeMsgTypeToVisMarkerType.obstacle_color_));
-            }
-            else
-            {
-                shape_msgs::Mesh m = msg->meshes[i];  // is only filled in case of no package file name has been given
-                sptr_Bvh.reset(new MarkerShape<BVH_RSS_t>(this->root_frame_id_,
-                                                          m,
-                                                          p,
-                                                          g_shapeMsgTypeToVisMarkerType.obstacle_color_));
-            }
+            sptr->updatePose(p);
+            success = true;
+        }
+    }
+    else
+    {
+        const std::string package_file_name = msg.type.db;  // using db field for package name instead of db json string
+        if (package_file_name.length() <= 0 && msg.mesh_poses.size() != msg.meshes.size())
+        {
+            ROS_ERROR("Mesh poses and meshes do not have the same size. If package resource string is empty then the sizes must be equal!");
+            return false;
+        }
 
-            this->addObstacle(msg->id, sptr_Bvh);
+        if (msg.primitive_poses.size() != msg.primitives.size())
+        {
+            ROS_ERROR("Primitive poses and primitives do not have the same size.");
+            return false;
+        }
+
+        const size_t num_parts = msg.primitives.size() + msg.mesh_poses.size();
+        if (num_parts > 1)
+        {
+            success = this->buildObstacleCompound(msg, frame_transform_root);
+        }
+        else if (msg.primitives.size() > 0)
+        {
+            success = this->buildObstaclePrimitive(msg, frame_transform_root);
+        }
+        else if (msg.mesh_poses.size() > 0)
+        {
+            success = this->buildObstacleMesh(msg, frame_transform_root);
+        }
+        else
+        {
+            ROS_ERROR_STREAM("registerObstacle: Element " << msg.id << " has neither primitives nor meshes!");
         }
     }
-    else if (msg->MOVE == msg->operation)
+
+    if (success && this->static_field_)
     {
+        // Added and moved obstacles are rasterized again, only their grid is rebuilt in the background. Until it is
+        // swapped in, the obstacle is handled by the narrow phase, so an obstacle that keeps moving just stays there.
         PtrIMarkerShape_t sptr;
-        for (uint32_t i = 0; i < m_size; ++i)
+        if (this->obstacle_mgr_->getShape(msg.id, sptr))
         {
-            if (this->obstacle_mgr_->getShape(msg->id, sptr))
-            {
-                geometry_msgs::Pose p = msg->mesh_poses[i];
-                tf::Pose tf_p;
-                tf::poseMsgToTF(p, tf_p);
-                tf::Pose new_tf_p = transform * tf_p;
-                tf::poseTFToMsg(new_tf_p, p);
-                sptr->updatePose(p);
-            }
+            this->static_field_->setObstacle(msg.id, sptr->getCollisionObject());
         }
     }
-    else if (msg->REMOVE == msg->operation)
+
+    return success;
+}
+
+
+bool DistanceManager::buildObstacleMesh(const moveit_msgs::CollisionObject& msg, const tf::StampedTransform& transform)
+{
+    const std::string package_file_name = msg.type.db;  // using db field for package name instead of db json string
+
+    geometry_msgs::Pose p = msg.mesh_poses[0];
+    tf::Pose tf_p;
+    tf::poseMsgToTF(p, tf_p);
+    tf::Pose new_tf_p = transform * tf_p;
+    tf::poseTFToMsg(new_tf_p, p);
+    PtrIMarkerShape_t sptr_Bvh;
+    if (package_file_name.length() > 0)
     {
-        this->obstacle_mgr_->removeShape(msg->id);
+        sptr_Bvh.reset(new MarkerShape<BVH_RSS_t>(this->root_frame_id_,
+                                                  package_file_name,
+                                                  p,
+                                                  g_shapeMsgTypeToVisMarkerType.obstacle_color_));
     }
     else
     {
-        ROS_ERROR_STREAM("Operation not supported!");
+        const shape_msgs::Mesh& m = msg.meshes[0];  // is only filled in case of no package file name has been given
+        sptr_Bvh.reset(new MarkerShape<BVH_RSS_t>(this->root_frame_id_,
+                                                  m,
+                                                  p,
+                                                  g_shapeMsgTypeToVisMarkerType.obstacle_color_));
     }
+
+    this->addObstacle(msg.id, sptr_Bvh);
+    return true;
 }
 
 
-void DistanceManager::buildObstaclePrimitive(const moveit_msgs::CollisionObject::ConstPtr& msg, const tf::StampedTransform& transform)
+bool DistanceManager::buildObstaclePrimitive(const moveit_msgs::CollisionObject& msg, const tf::StampedTransform& transform)
 {
-    uint32_t p_size = msg->primitives.size();
-    if (msg->primitives.size() > 1)
+    const shape_msgs::SolidPrimitive& sp = msg.primitives[0];
+    geometry_msgs::Pose p = msg.primitive_poses[0];
+    tf::Pose tf_p;
+    tf::poseMsgToTF(p, tf_p);
+    tf::Pose new_tf_p = transform * tf_p;
+    tf::poseTFToMsg(new_tf_p, p);
+
+    PtrIMarkerShape_t sptr;
+    Eigen::Vector3d dim;
+    if (shape_msgs::SolidPrimitive::BOX == sp.type)
     {
-        ROS_WARN("Currenty only one primitive per message is supported! So only the first one is processed ...");
-        p_size = 1;
+        dim(FCL_BOX_X) = sp.dimensions[shape_msgs::SolidPrimitive::BOX_X];
+        dim(FCL_BOX_Y) = sp.dimensions[shape_msgs::SolidPrimitive::BOX_Y];
+        dim(FCL_BOX_Z) = sp.dimensions[shape_msgs::SolidPrimitive::BOX_Z];
     }
-
-    if (msg->ADD == msg->operation)
+    else if (shape_msgs::SolidPrimitive::SPHERE == sp.type)
     {
-        for (uint32_t i = 0; i < p_size; ++i)
-        {
-            shape_msgs::SolidPrimitive sp = msg->primitives[i];
-            geometry_msgs::Pose p = msg->primitive_poses[i];
-            tf::Pose tf_p;
-            tf::poseMsgToTF(p, tf_p);
-            tf::Pose new_tf_p = transform * tf_p;
-            tf::poseTFToMsg(new_tf_p, p);
+        dim(FCL_RADIUS) = sp.dimensions[shape_msgs::SolidPrimitive::SPHERE_RADIUS];
+    }
+    else if (shape_msgs::SolidPrimitive::CYLINDER == sp.type)
+    {
+        dim(FCL_RADIUS) = sp.dimensions[shape_msgs::SolidPrimitive::CYLINDER_RADIUS];
+        dim(FCL_CYL_LENGTH) = sp.dimensions[shape_msgs::SolidPrimitive::CYLINDER_HEIGHT];
+    }
+    else
+    {
+        ROS_ERROR_STREAM("Shape type not supported: " << sp.type);
+        return false;
+    }
 
-            PtrIMarkerShape_t sptr;
-            Eigen::Vector3d dim;
-            if (shape_msgs::SolidPrimitive::BOX == sp.type)
-            {
-                dim(FCL_BOX_X) = sp.dimensions[shape_msgs::SolidPrimitive::BOX_X];
-                dim(FCL_BOX_Y) = sp.dimensions[shape_msgs::SolidPrimitive::BOX_Y];
-                dim(FCL_BOX_Z) = sp.dimensions[shape_msgs::SolidPrimitive::BOX_Z];
-            }
-            else if (shape_msgs::SolidPrimitive::SPHERE == sp.type)
-            {
-                dim(FCL_RADIUS) = sp.dimensions[shape_msgs::SolidPrimitive::SPHERE_RADIUS];
-            }
-            else if (shape_msgs::SolidPrimitive::CYLINDER == sp.type)
-            {
-                dim(FCL_RADIUS) = sp.dimensions[shape_msgs::SolidPrimitive::CYLINDER_RADIUS];
-                dim(FCL_CYL_LENGTH) = sp.dimensions[shape_msgs::SolidPrimitive::CYLINDER_HEIGHT];
-            }
-            else
-            {
-                ROS_ERROR_STREAM("Shape type not supported: " << sp.type);
-                break;
-            }
+    uint32_t shape_type = g_shapeMsgTypeToVisMarkerType.map_[sp.type];
+    this->link_to_collision_.getMarkerShapeFromType(shape_type,
+                                                     p,
+                                                     msg.id,
+                                                     dim,
+                                                     sptr);
+    this->addObstacle(msg.id, sptr);
+    return true;
+}
 
-            uint32_t shape_type = g_shapeMsgTypeToVisMarkerType.map_[sp.type];
-            this->link_to_collision_.getMarkerShapeFromType(shape_type,
-                                                             p,
-                                                             msg->id,
-                                                             dim,
-                                                             sptr);
-            this->addObstacle(msg->id, sptr);
+
+bool DistanceManager::buildObstacleCompound(const moveit_msgs::CollisionObject& msg, const tf::StampedTransform& transform)
+{
+    const geometry_msgs::Pose& object_pose = msg.primitive_poses.empty() ? msg.mesh_poses[0] : msg.primitive_poses[0];
+    tf::Pose tf_object;
+    tf::poseMsgToTF(object_pose, tf_object);
+    const tf::Transform object_inv = tf_object.inverse();
+
+    shape_msgs::Mesh compound;
+    for (uint32_t i = 0; i < msg.primitives.size(); ++i)
+    {
+        const shape_msgs::SolidPrimitive& sp = msg.primitives[i];
+        BVH_RSS_t bvh;
+        if (shape_msgs::SolidPrimitive::BOX == sp.type)
+        {
+            fcl::Box b(sp.dimensions[shape_msgs::SolidPrimitive::BOX_X],
+                       sp.dimensions[shape_msgs::SolidPrimitive::BOX_Y],
+                       sp.dimensions[shape_msgs::SolidPrimitive::BOX_Z]);
+            FclMarkerConverter<fcl::Box> converter(b);
+            converter.getBvhModel(bvh);
+        }
+        else if (shape_msgs::SolidPrimitive::SPHERE == sp.type)
+        {
+            fcl::Sphere s(sp.dimensions[shape_msgs::SolidPrimitive::SPHERE_RADIUS]);
+            FclMarkerConverter<fcl::Sphere> converter(s);
+            converter.getBvhModel(bvh);
         }
+        else if (shape_msgs::SolidPrimitive::CYLINDER == sp.type)
+        {
+            fcl::Cylinder c(sp.dimensions[shape_msgs::SolidPrimitive::CYLINDER_RADIUS],
+                            sp.dimensions[shape_msgs::SolidPrimitive::CYLINDER_HEIGHT]);
+            FclMarkerConverter<fcl::Cylinder> converter(c);
+            converter.getBvhModel(bvh);
+        }
+        else
+        {
+            ROS_ERROR_STREAM("Shape type not supported: " << sp.type);
+            return false;
+        }
+
+        tf::Pose tf_part;
+        tf::poseMsgToTF(msg.primitive_poses[i], tf_part);
+        appendToMesh(bvh, object_inv * tf_part, compound);
     }
-    else if (msg->MOVE == msg->operation)
+
+    const std::string package_file_name = msg.type.db;  // using db field for package name instead of db json string
+    std::shared_ptr<BVH_RSS_t> resource_bvh;
+    if (package_file_name.length() > 0 && msg.mesh_poses.size() > 0)
     {
-        PtrIMarkerShape_t sptr;
-        for (uint32_t i = 0; i < p_size; ++i)
+        PtrConstSphereProxy_t resource_proxy;
+        resource_bvh = MeshCache::getInstance().getBvh(package_file_name, resource_proxy);
+        if (!resource_bvh)
         {
-            if (this->obstacle_mgr_->getShape(msg->id, sptr))
-            {
-                geometry_msgs::Pose p = msg->primitive_poses[i];
-                tf::Pose tf_p;
-                tf::poseMsgToTF(p, tf_p);
-                tf::Pose new_tf_p = transform * tf_p;
-                tf::poseTFToMsg(new_tf_p, p);
-                sptr->updatePose(p);
-            }
+            ROS_ERROR_STREAM("registerObstacle: Could not load mesh resource " << package_file_name << " of " << msg.id);
+            return false;
         }
     }
-    else if (msg->REMOVE == msg->operation)
+
+    for (uint32_t i = 0; i < msg.mesh_poses.size(); ++i)
     {
-        this->obstacle_mgr_->removeShape(msg->id);
+        tf::Pose tf_part;
+        tf::poseMsgToTF(msg.mesh_poses[i], tf_part);
+        if (resource_bvh)
+        {
+            appendToMesh(*resource_bvh, object_inv * tf_part, compound);
+        }
+        else
+        {
+            appendToMesh(msg.meshes[i], object_inv * tf_part, compound);
+        }
     }
-    else
+
+    geometry_msgs::Pose p;
+    tf::poseTFToMsg(transform * tf_object, p);
+    PtrIMarkerShape_t sptr(new MarkerShape<BVH_RSS_t>(this->root_frame_id_,
+                                                      compound,
+                                                      p,
+                                                      g_shapeMsgTypeToVisMarkerType.obstacle_color_));
+    this->addObstacle(msg.id, sptr);
+    return true;
+}
+
+
+void DistanceManager::removeObstacle(const std::string& obstacle_id)
+{
+    this->obstacle_mgr_->removeShape(obstacle_id);
+    this->removeFromPairCache(obstacle_id);
+    if (this->static_field_)
     {
-        ROS_ERROR_STREAM("Operation not supported!");
+        this->static_field_->removeObstacle(obstacle_id);
     }
 }
 
@@ -604,6 +1456,7 @@ void DistanceManager::buildObstaclePrimitive(const moveit_msgs::CollisionObject:
 bool DistanceManager::registerLinkOfInterest(cob_srvs::SetString::Request& request,
                                               cob_srvs::SetString::Response& response)
 {
+    std::lock_guard<std::mutex> lock(object_of_interest_mgr_mtx_);
     if (this->object_of_interest_mgr_->count(request.data) > 0)
     {
         response.success = true;
@@ -641,6 +1494,15 @@ bool DistanceManager::registerLinkOfInterest(cob_srvs::SetString::Request& reque
 }
 
 
+void DistanceManager::removeFromPairCache(const std::string& obstacle_id)
+{
+    for (PairCache_t::iterator it = this->pair_cache_.begin(); it != this->pair_cache_.end(); ++it)
+    {
+        it->second.erase(obstacle_id);
+    }
+}
+
+
 Eigen::Affine3d DistanceManager::getSynchedCbToBlTransform()
 {
     std::lock_guard<std::mutex> lock(mtx_);
@@ -16,9 +16,10 @@
 
 
 #include <string>
+#include <vector>
 
 #include "cob_obstacle_distance/marker_shapes/marker_shapes.hpp"
-#include "cob_obstacle_distance/parsers/mesh_parser.hpp"
+#include "cob_obstacle_distance/marker_shapes/mesh_cache.hpp"
 
 /* BEGIN MarkerShape ********************************************************************************************/
 MarkerShape<BVH_RSS_t>::MarkerShape(const std::string& root_frame,
@@ -26,40 +27,36 @@ MarkerShape<BVH_RSS_t>::MarkerShape(const std::string& root_frame,
                                     const geometry_msgs::Pose& pose,
                                     const std_msgs::ColorRGBA& col)
 {
-    this->ptr_fcl_bvh_.reset(new BVH_RSS_t());
-    this->ptr_fcl_bvh_->beginModel();
-    for (shape_msgs::MeshTriangle tri : mesh.triangles)
-    {
-        uint32_t v_idx_1 = tri.vertex_indices.elems[0];
-        uint32_t v_idx_2 = tri.vertex_indices.elems[1];
-        uint32_t v_idx_3 = tri.vertex_indices.elems[2];
-
-        fcl::Vec3f v1(mesh.vertices[v_idx_1].x, mesh.vertices[v_idx_1].y, mesh.vertices[v_idx_1].z);
-        fcl::Vec3f v2(mesh.vertices[v_idx_2].x, mesh.vertices[v_idx_2].y, mesh.vertices[v_idx_2].z);
-        fcl::Vec3f v3(mesh.vertices[v_idx_3].x, mesh.vertices[v_idx_3].y, mesh.vertices[v_idx_3].z);
-
-        this->ptr_fcl_bvh_->addTriangle(v1, v2, v3);
-    }
-
-    this->ptr_fcl_bvh_->endModel();
-    this->ptr_fcl_bvh_->computeLocalAABB();
+    this->ptr_fcl_bvh_ = MeshCache::getInstance().getBvh(mesh, this->proxy_);
 
+    origin_ = pose;
     marker_.pose = pose;
     marker_.color = col;
 
     marker_.scale.x = 1.0;
     marker_.scale.y = 1.0;
     marker_.scale.z = 1.0;
-    marker_.type = visualization_msgs::Marker::MESH_RESOURCE;
+
+    // There is no mesh resource for a mesh given by message (e.g. moveit_msgs/CollisionObject): draw its triangles directly.
+    marker_.type = visualization_msgs::Marker::TRIANGLE_LIST;
+    marker_.points.reserve(3 * mesh.triangles.size());
+    for (std::vector<shape_msgs::MeshTriangle>::const_iterator it = mesh.triangles.begin(); it != mesh.triangles.end(); ++it)
+    {
+        for (uint32_t i = 0; i < 3; ++i)
+        {
+            marker_.points.push_back(mesh.vertices[it->vertex_indices[i]]);
+        }
+    }
 
     marker_.header.frame_id = root_frame;
     marker_.header.stamp = ros::Time::now();
     marker_.ns = g_marker_namespace;
     marker_.action = visualization_msgs::Marker::ADD;
     marker_.id = IMarkerShape::class_ctr_;
-    marker_.mesh_resource = "";  // TODO: Not given in this case: can happen e.g. when moveit_msgs/CollisionObject was given!
 
     marker_.lifetime = ros::Duration();
+
+    this->initCollisionObject(this->ptr_fcl_bvh_);
 }
 
 
@@ -76,12 +73,11 @@ void MarkerShape<BVH_RSS_t>::init(const std::string& mesh_resource, const std::s
           double quat_x, double quat_y, double quat_z, double quat_w,
           double color_r, double color_g, double color_b, double color_a)
 {
-    MeshParser sp(mesh_resource);
-    this->ptr_fcl_bvh_.reset(new BVH_RSS_t());
-
-    if (0 != sp.createBVH(this->ptr_fcl_bvh_))
+    this->ptr_fcl_bvh_ = MeshCache::getInstance().getBvh(mesh_resource, this->proxy_);
+    if (!this->ptr_fcl_bvh_)
     {
         ROS_ERROR("Could not create BVH model!");
+        this->ptr_fcl_bvh_.reset(new BVH_RSS_t());
     }
 
     marker_.pose.position.x = origin_.position.x = x;
@@ -111,6 +107,8 @@ void MarkerShape<BVH_RSS_t>::init(const std::string& mesh_resource, const std::s
     marker_.mesh_use_embedded_materials = true;
 
     marker_.lifetime = ros::Duration();
+
+    this->initCollisionObject(this->ptr_fcl_bvh_);
 }
 
 
@@ -143,16 +141,18 @@ inline void MarkerShape<BVH_RSS_t>::setColor(double color_r, double color_g, dou
 
 inline void MarkerShape<BVH_RSS_t>::updatePose(const geometry_msgs::Vector3& pos, const geometry_msgs::Quaternion& quat)
 {
-    marker_.pose.position.x = pos.x;
-    marker_.pose.position.y = pos.y;
-    marker_.pose.position.z = pos.z;
-    marker_.pose.orientation = quat;
+    geometry_msgs::Pose pose;
+    pose.position.x = pos.x;
+    pose.position.y = pos.y;
+    pose.position.z = pos.z;
+    pose.orientation = quat;
+    this->setPose(pose);
 }
 
 
 inline void MarkerShape<BVH_RSS_t>::updatePose(const geometry_msgs::Pose& pose)
 {
-    marker_.pose = pose;
+    this->setPose(pose);
 }
 
 
@@ -162,19 +162,4 @@ inline visualization_msgs::Marker MarkerShape<BVH_RSS_t>::getMarker()
     return this->marker_;
 }
 
-
-fcl::CollisionObject MarkerShape<BVH_RSS_t>::getCollisionObject() const
-{
-    fcl::Transform3f x(fcl::Quaternion3f(this->marker_.pose.orientation.w,
-                                         this->marker_.pose.orientation.x,
-                                         this->marker_.pose.orientation.y,
-                                         this->marker_.pose.orientation.z),
-                       fcl::Vec3f(this->marker_.pose.position.x,
-                                  this->marker_.pose.position.y,
-                                  this->marker_.pose.position.z));
-
-    fcl::CollisionObject cobj(this->ptr_fcl_bvh_, x);
-    return cobj;
-}
-
 /* END MarkerShape **********************************************************************************************/
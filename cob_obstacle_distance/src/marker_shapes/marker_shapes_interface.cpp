@@ -19,10 +19,51 @@
 
 /* BEGIN IMarkerShape *******************************************************************************************/
 /// Interface class marking methods that have to be implemented in derived classes.
-IMarkerShape::IMarkerShape()
+IMarkerShape::IMarkerShape() : moved_(true)
 {
     class_ctr_++;
 }
 
+
+void IMarkerShape::initCollisionObject(const std::shared_ptr<fcl::CollisionGeometry>& geometry)
+{
+    fcl::Transform3f x(fcl::Quaternion3f(this->marker_.pose.orientation.w,
+                                         this->marker_.pose.orientation.x,
+                                         this->marker_.pose.orientation.y,
+                                         this->marker_.pose.orientation.z),
+                       fcl::Vec3f(this->marker_.pose.position.x,
+                                  this->marker_.pose.position.y,
+                                  this->marker_.pose.position.z));
+    this->collision_object_.reset(new fcl::CollisionObject(geometry, x));
+    this->moved_ = true;
+}
+
+
+void IMarkerShape::setPose(const geometry_msgs::Pose& pose)
+{
+    const geometry_msgs::Pose& last = this->marker_.pose;
+    const bool changed = last.position.x != pose.position.x ||
+                         last.position.y != pose.position.y ||
+                         last.position.z != pose.position.z ||
+                         last.orientation.x != pose.orientation.x ||
+                         last.orientation.y != pose.orientation.y ||
+                         last.orientation.z != pose.orientation.z ||
+                         last.orientation.w != pose.orientation.w;
+    this->marker_.pose = pose;
+
+    if (changed && this->collision_object_)
+    {
+        this->collision_object_->setTransform(fcl::Quaternion3f(pose.orientation.w,
+                                                                pose.orientation.x,
+                                                                pose.orientation.y,
+                                                                pose.orientation.z),
+                                              fcl::Vec3f(pose.position.x,
+                                                         pose.position.y,
+                                                         pose.position.z));
+        this->collision_object_->computeAABB();
+        this->moved_ = true;
+    }
+}
+
 uint32_t IMarkerShape::class_ctr_ = 0;
 /* END IMarkerShape *********************************************************************************************/
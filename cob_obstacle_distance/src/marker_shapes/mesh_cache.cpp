@@ -0,0 +1,245 @@
+/*
+ * Copyright 2017 Fraunhofer Institute for Manufacturing Engineering and Automation (IPA)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <sstream>
+#include <string>
+
+#include <ros/ros.h>
+#include <boost/algorithm/string/case_conv.hpp>
+#include <boost/filesystem.hpp>
+
+#include "cob_obstacle_distance/marker_shapes/mesh_cache.hpp"
+#include "cob_obstacle_distance/parsers/mesh_parser.hpp"
+#include "cob_obstacle_distance/parsers/stl_parser.hpp"
+#include "cob_obstacle_distance/helpers/helper_functions.hpp"
+
+#define FNV_OFFSET_BASIS 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+
+/**
+ * FNV-1a hash over a byte range.
+ * @param hash The hash of the preceding bytes (FNV_OFFSET_BASIS at start).
+ * @param data Pointer to the bytes.
+ * @param size Number of bytes.
+ * @return The updated hash.
+ */
+static uint64_t fnv1a(uint64_t hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+
+/**
+ * Removes the entries whose BVH model has already been released by all shapes.
+ * @param entries The cache entries.
+ */
+template <typename T>
+static void pruneExpired(std::unordered_map<std::string, T>& entries)
+{
+    for (typename std::unordered_map<std::string, T>::iterator it = entries.begin(); it != entries.end();)
+    {
+        if (it->second.bvh_.expired())
+        {
+            it = entries.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+
+MeshCache& MeshCache::getInstance()
+{
+    static MeshCache instance;
+    return instance;
+}
+
+
+void MeshCache::setDeduplicateVertices(bool deduplicate_vertices)
+{
+    std::lock_guard<std::mutex> lock(this->mtx_);
+    this->deduplicate_vertices_ = deduplicate_vertices;
+}
+
+
+std::string MeshCache::contentKey(const shape_msgs::Mesh& mesh)
+{
+    uint64_t hash = FNV_OFFSET_BASIS;
+    for (std::vector<geometry_msgs::Point>::const_iterator it = mesh.vertices.begin(); it != mesh.vertices.end(); ++it)
+    {
+        const double v[3] = {it->x, it->y, it->z};
+        hash = fnv1a(hash, v, sizeof(v));
+    }
+
+    for (std::vector<shape_msgs::MeshTriangle>::const_iterator it = mesh.triangles.begin(); it != mesh.triangles.end(); ++it)
+    {
+        hash = fnv1a(hash, it->vertex_indices.elems, sizeof(it->vertex_indices.elems));
+    }
+
+    std::ostringstream key;
+    key << mesh.vertices.size() << "/" << mesh.triangles.size() << "/" << std::hex << hash;
+    return key.str();
+}
+
+
+bool MeshCache::sameContent(const shape_msgs::Mesh& a, const shape_msgs::Mesh& b)
+{
+    if (a.vertices.size() != b.vertices.size() || a.triangles.size() != b.triangles.size())
+    {
+        return false;
+    }
+
+    for (std::size_t i = 0; i < a.vertices.size(); ++i)
+    {
+        if (a.vertices[i].x != b.vertices[i].x || a.vertices[i].y != b.vertices[i].y || a.vertices[i].z != b.vertices[i].z)
+        {
+            return false;
+        }
+    }
+
+    for (std::size_t i = 0; i < a.triangles.size(); ++i)
+    {
+        if (a.triangles[i].vertex_indices != b.triangles[i].vertex_indices)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+std::shared_ptr<BVH_RSS_t> MeshCache::getBvh(const std::string& mesh_resource, PtrConstSphereProxy_t& proxy)
+{
+    std::lock_guard<std::mutex> lock(this->mtx_);
+
+    std::string file_path = mesh_resource;
+    if (!boost::filesystem::exists(file_path))
+    {
+        file_path = resolveURI(mesh_resource);
+    }
+
+    boost::system::error_code ec;
+    std::time_t mtime = boost::filesystem::last_write_time(file_path, ec);
+    if (ec)
+    {
+        ROS_ERROR_STREAM("MeshCache: Could not access mesh file " << file_path << ": " << ec.message());
+        return std::shared_ptr<BVH_RSS_t>();
+    }
+
+    std::shared_ptr<BVH_RSS_t> bvh;
+    std::unordered_map<std::string, FileEntry>::const_iterator cached = this->file_entries_.find(file_path);
+    if (this->file_entries_.end() != cached)
+    {
+        bvh = cached->second.bvh_.lock();
+        if (bvh && cached->second.mtime_ == mtime)
+        {
+            ROS_DEBUG_STREAM("MeshCache: Reusing BVH model of " << file_path);
+            proxy = cached->second.proxy_.lock();
+            return bvh;
+        }
+    }
+
+    // only misses insert, so pruning here bounds the map by the number of models in use
+    pruneExpired(this->file_entries_);
+
+    int8_t success = -1;
+    bvh.reset(new BVH_RSS_t());
+    if (".stl" == boost::algorithm::to_lower_copy(boost::filesystem::path(file_path).extension().string()))
+    {
+        StlParser stl_parser(file_path, this->deduplicate_vertices_);
+        success = stl_parser.createBVH(bvh);
+        if (0 != success)
+        {
+            ROS_WARN_STREAM("MeshCache: Could not read " << file_path << " as STL, falling back to Assimp.");
+            bvh.reset(new BVH_RSS_t());
+        }
+    }
+
+    if (0 != success)
+    {
+        MeshParser parser(file_path, this->deduplicate_vertices_);
+        success = parser.createBVH(bvh);
+    }
+
+    if (0 != success)
+    {
+        ROS_ERROR_STREAM("MeshCache: Could not create BVH model from " << file_path);
+        this->file_entries_.erase(file_path);
+        return std::shared_ptr<BVH_RSS_t>();
+    }
+
+    proxy = SphereProxy::create(*bvh);
+    FileEntry& entry = this->file_entries_[file_path];
+    entry.mtime_ = mtime;
+    entry.bvh_ = bvh;
+    entry.proxy_ = proxy;
+    return bvh;
+}
+
+
+std::shared_ptr<BVH_RSS_t> MeshCache::getBvh(const shape_msgs::Mesh& mesh, PtrConstSphereProxy_t& proxy)
+{
+    const std::string key = contentKey(mesh);
+    std::lock_guard<std::mutex> lock(this->mtx_);
+
+    std::shared_ptr<BVH_RSS_t> bvh;
+    std::unordered_map<std::string, MeshEntry>::const_iterator cached = this->mesh_entries_.find(key);
+    if (this->mesh_entries_.end() != cached)
+    {
+        bvh = cached->second.bvh_.lock();
+        if (bvh && sameContent(cached->second.mesh_, mesh))
+        {
+            ROS_DEBUG_STREAM("MeshCache: Reusing BVH model for mesh " << key);
+            proxy = cached->second.proxy_.lock();
+            return bvh;
+        }
+    }
+
+    pruneExpired(this->mesh_entries_);
+
+    bvh.reset(new BVH_RSS_t());
+    bvh->beginModel();
+    for (std::vector<shape_msgs::MeshTriangle>::const_iterator it = mesh.triangles.begin(); it != mesh.triangles.end(); ++it)
+    {
+        const geometry_msgs::Point& p1 = mesh.vertices[it->vertex_indices.elems[0]];
+        const geometry_msgs::Point& p2 = mesh.vertices[it->vertex_indices.elems[1]];
+        const geometry_msgs::Point& p3 = mesh.vertices[it->vertex_indices.elems[2]];
+        bvh->addTriangle(fcl::Vec3f(p1.x, p1.y, p1.z), fcl::Vec3f(p2.x, p2.y, p2.z), fcl::Vec3f(p3.x, p3.y, p3.z));
+    }
+
+    bvh->endModel();
+    bvh->computeLocalAABB();
+
+    proxy = SphereProxy::create(*bvh);
+    // a colliding key replaces the entry, shapes using the previous model keep it alive
+    MeshEntry& entry = this->mesh_entries_[key];
+    entry.mesh_ = mesh;
+    entry.bvh_ = bvh;
+    entry.proxy_ = proxy;
+    return bvh;
+}
@@ -0,0 +1,195 @@
+/*
+ * Copyright 2017 Fraunhofer Institute for Manufacturing Engineering and Automation (IPA)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <vector>
+
+#include <ros/ros.h>
+
+#include "cob_obstacle_distance/marker_shapes/sphere_proxy.hpp"
+
+double SphereProxy::error_bound_ = 0.0;
+uint32_t SphereProxy::max_spheres_ = 1;
+
+/// A set of triangles and its enclosing sphere while building the proxy.
+struct SphereCluster
+{
+    std::vector<uint32_t> triangles_;
+    SphereProxy::Sphere sphere_;
+
+    bool operator<(const SphereCluster& other) const
+    {
+        return this->sphere_.radius_ < other.sphere_.radius_;
+    }
+};
+
+
+/**
+ * Encloses all vertices of the triangles of a cluster by a sphere around the center of their AABB.
+ */
+static void encloseCluster(const std::vector<fcl::Vec3f>& vertices, const std::vector<fcl::Triangle>& triangles, SphereCluster& cluster)
+{
+    fcl::AABB aabb;
+    for (std::vector<uint32_t>::const_iterator it = cluster.triangles_.begin(); it != cluster.triangles_.end(); ++it)
+    {
+        for (uint8_t k = 0; k < 3; ++k)
+        {
+            aabb += vertices[triangles[*it][k]];
+        }
+    }
+
+    double radius_sqr = 0.0;
+    const fcl::Vec3f center = aabb.center();
+    for (std::vector<uint32_t>::const_iterator it = cluster.triangles_.begin(); it != cluster.triangles_.end(); ++it)
+    {
+        for (uint8_t k = 0; k < 3; ++k)
+        {
+            radius_sqr = std::max(radius_sqr, (vertices[triangles[*it][k]] - center).sqrLength());
+        }
+    }
+
+    cluster.sphere_.center_ = center;
+    cluster.sphere_.radius_ = std::sqrt(radius_sqr);
+}
+
+
+void SphereProxy::build(const std::vector<fcl::Vec3f>& vertices, const std::vector<fcl::Triangle>& triangles, double error_bound, uint32_t max_spheres)
+{
+    if (triangles.empty())
+    {
+        return;
+    }
+
+    std::priority_queue<SphereCluster> clusters;  // largest sphere first
+    SphereCluster all;
+    all.triangles_.resize(triangles.size());
+    for (uint32_t i = 0; i < triangles.size(); ++i)
+    {
+        all.triangles_[i] = i;
+    }
+
+    encloseCluster(vertices, triangles, all);
+    clusters.push(all);
+
+    while (clusters.size() < max_spheres && clusters.top().sphere_.radius_ > error_bound && clusters.top().triangles_.size() > 1)
+    {
+        SphereCluster cluster = clusters.top();
+        clusters.pop();
+
+        // split at the median triangle centroid along the longest axis of the sphere's AABB
+        fcl::AABB aabb;
+        for (std::vector<uint32_t>::const_iterator it = cluster.triangles_.begin(); it != cluster.triangles_.end(); ++it)
+        {
+            aabb += (vertices[triangles[*it][0]] + vertices[triangles[*it][1]] + vertices[triangles[*it][2]]) / 3.0;
+        }
+
+        uint8_t axis = 0;
+        if (aabb.height() > aabb.width())
+        {
+            axis = 1;
+        }
+
+        if (aabb.depth() > std::max(aabb.width(), aabb.height()))
+        {
+            axis = 2;
+        }
+
+        std::vector<uint32_t>::iterator median = cluster.triangles_.begin() + cluster.triangles_.size() / 2;
+        std::nth_element(cluster.triangles_.begin(), median, cluster.triangles_.end(),
+                         [&vertices, &triangles, axis](uint32_t a, uint32_t b)
+                         {
+                             return vertices[triangles[a][0]][axis] + vertices[triangles[a][1]][axis] + vertices[triangles[a][2]][axis] <
+                                    vertices[triangles[b][0]][axis] + vertices[triangles[b][1]][axis] + vertices[triangles[b][2]][axis];
+                         });
+
+        SphereCluster lower;
+        SphereCluster upper;
+        lower.triangles_.assign(cluster.triangles_.begin(), median);
+        upper.triangles_.assign(median, cluster.triangles_.end());
+        encloseCluster(vertices, triangles, lower);
+        encloseCluster(vertices, triangles, upper);
+        clusters.push(lower);
+        clusters.push(upper);
+    }
+
+    this->achieved_error_ = clusters.top().sphere_.radius_;
+    if (this->achieved_error_ > error_bound && clusters.size() >= max_spheres)
+    {
+        ROS_WARN_STREAM("SphereProxy: " << max_spheres << " spheres only achieve an error of " << this->achieved_error_ <<
+                        " m instead of " << error_bound << " m. Increase \"lod_max_spheres\" for a tighter proxy.");
+    }
+
+    this->spheres_.reserve(clusters.size());
+    while (!clusters.empty())
+    {
+        this->spheres_.push_back(clusters.top().sphere_);
+        clusters.pop();
+    }
+}
+
+
+double SphereProxy::distance(const fcl::Transform3f& tf, const SphereProxy& other, const fcl::Transform3f& other_tf, double stop_below) const
+{
+    std::vector<fcl::Vec3f> other_centers;
+    other_centers.reserve(other.spheres_.size());
+    for (std::vector<Sphere>::const_iterator it = other.spheres_.begin(); it != other.spheres_.end(); ++it)
+    {
+        other_centers.push_back(other_tf.transform(it->center_));
+    }
+
+    double min_distance = std::numeric_limits<double>::max();
+    for (std::vector<Sphere>::const_iterator it = this->spheres_.begin(); it != this->spheres_.end(); ++it)
+    {
+        const fcl::Vec3f center = tf.transform(it->center_);
+        for (uint32_t j = 0; j < other_centers.size(); ++j)
+        {
+            const double d = (center - other_centers[j]).length() - it->radius_ - other.spheres_[j].radius_;
+            if (d < min_distance)
+            {
+                min_distance = d;
+                if (min_distance < stop_below)
+                {
+                    return min_distance;
+                }
+            }
+        }
+    }
+
+    return min_distance;
+}
+
+
+void SphereProxy::setLevelOfDetail(double error_bound, uint32_t max_spheres)
+{
+    error_bound_ = error_bound;
+    max_spheres_ = std::max(1u, max_spheres);
+}
+
+
+double SphereProxy::getErrorBound()
+{
+    return error_bound_;
+}
+
+
+uint32_t SphereProxy::getMaxSpheres()
+{
+    return max_spheres_;
+}
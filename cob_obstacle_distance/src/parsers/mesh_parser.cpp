@@ -25,15 +25,14 @@
 #include "cob_obstacle_distance/parsers/mesh_parser.hpp"
 #include "cob_obstacle_distance/helpers/helper_functions.hpp"
 
-#define MAX_NUM_MESHES 1
-
 /**
  * Read from a mesh file by using assimp Importer.
- * Iterates through the faces and tries to convert the corresponding vertices into a triangle vector.
- * @param tri_vec Reference to a triangle vector storing the mesh data.
+ * All meshes of the scene are imported with their node transformations applied and appended to one indexed triangle mesh.
+ * @param vertices Reference to the vertex buffer storing the mesh data.
+ * @param triangles Reference to the index buffer storing the mesh data.
  * @return Success status (0 means ok).
  */
-int8_t MeshParser::read(std::vector<TriangleSupport>& tri_vec)
+int8_t MeshParser::read(std::vector<fcl::Vec3f>& vertices, std::vector<fcl::Triangle>& triangles)
 {
     std::string file_path = this->file_path_;
     if (!boost::filesystem::exists(this->file_path_))
@@ -43,8 +42,13 @@ int8_t MeshParser::read(std::vector<TriangleSupport>& tri_vec)
 
     // Create an instance of the Importer class
     Assimp::Importer importer;
-    const aiScene* scene = importer.ReadFile(file_path,
-                                             0);
+    unsigned int flags = aiProcess_Triangulate | aiProcess_PreTransformVertices | aiProcess_SortByPType;
+    if (this->deduplicate_vertices_)
+    {
+        flags |= aiProcess_JoinIdenticalVertices;
+    }
+
+    const aiScene* scene = importer.ReadFile(file_path, flags);
     if (!scene)
     {
         ROS_ERROR_STREAM("Assimp::Importer Error: " << importer.GetErrorString());
@@ -57,59 +61,47 @@ int8_t MeshParser::read(std::vector<TriangleSupport>& tri_vec)
         return -2;
     }
 
-    if (MAX_NUM_MESHES < scene->mNumMeshes)
+    size_t num_vertices = vertices.size();
+    size_t num_triangles = triangles.size();
+    for (uint32_t m = 0; m < scene->mNumMeshes; ++m)
     {
-        ROS_WARN("Found more than one mesh in mesh file. The current implementation can only process %d mesh!!!", static_cast<uint32_t>(MAX_NUM_MESHES));
+        num_vertices += scene->mMeshes[m]->mNumVertices;
+        num_triangles += scene->mMeshes[m]->mNumFaces;
     }
 
-    aiMesh** mesh = scene->mMeshes;
-    aiVector3D* vertex = mesh[0]->mVertices;  // point to the first vertex
-
-    ROS_DEBUG_STREAM("mesh[0]->mNumVertices: " << mesh[0]->mNumVertices);
-    ROS_DEBUG_STREAM("mesh[0]->mNumFaces: " << mesh[0]->mNumFaces);  // num of faces == num of triangles in STL
+    vertices.reserve(num_vertices);
+    triangles.reserve(num_triangles);
 
-    // now read in all the triangles
-    for (uint32_t i = 0; i < mesh[0]->mNumFaces; ++i)
+    for (uint32_t m = 0; m < scene->mNumMeshes; ++m)
     {
-        // populate each point of the triangle
-        TriangleSupport t;
-        if (0 != this->toVec3f(i, vertex++, t.a))  // after processing the pointer will be increased to point to the next vertex!
-        {
-            break;
-        }
+        const aiMesh* mesh = scene->mMeshes[m];
+        const uint32_t offset = vertices.size();
+        ROS_DEBUG_STREAM("mesh[" << m << "]->mNumVertices: " << mesh->mNumVertices);
+        ROS_DEBUG_STREAM("mesh[" << m << "]->mNumFaces: " << mesh->mNumFaces);
 
-        if (0 != this->toVec3f(i, vertex++, t.b))
+        for (uint32_t i = 0; i < mesh->mNumVertices; ++i)
         {
-            break;
+            const aiVector3D& v = mesh->mVertices[i];
+            vertices.push_back(fcl::Vec3f(v.x, v.y, v.z));
         }
 
-        if (0 != this->toVec3f(i, vertex++, t.c))
+        for (uint32_t i = 0; i < mesh->mNumFaces; ++i)
         {
-            break;
-        }
+            const aiFace& face = mesh->mFaces[i];
+            if (3 != face.mNumIndices)
+            {
+                continue;  // points and lines do not contribute to the collision geometry
+            }
 
-        tri_vec.push_back(t);
+            triangles.push_back(fcl::Triangle(offset + face.mIndices[0], offset + face.mIndices[1], offset + face.mIndices[2]));
+        }
     }
 
-    return 0;
-}
-
-/**
- * Uses the current vertex (assimp 3d vector) and converts into fcl::Vec3f.
- * @param num_current_face The number of the current face for error logging.
- * @param vertex Pointer to the current vertex.
- * @param out The fcl vector description.
- * @return Success status (0 means ok).
- */
-int8_t MeshParser::toVec3f(uint32_t num_current_face, aiVector3D* vertex, fcl::Vec3f& out)
-{
-    if (!vertex)
+    if (triangles.empty())
     {
-        ROS_ERROR("No valid vertex found at face %d", num_current_face);
+        ROS_ERROR("Found no triangles in mesh file. Aborting ...");
         return -3;
     }
 
-    out = fcl::Vec3f((*vertex)[0], (*vertex)[1], (*vertex)[2]);
     return 0;
 }
-
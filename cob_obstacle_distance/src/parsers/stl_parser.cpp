@@ -15,108 +15,215 @@
  */
 
 
+#include <algorithm>
 #include <string>
 #include <vector>
+#include <cstring>
+#include <cstdlib>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <boost/filesystem.hpp>
 #include <ros/ros.h>
-#include <fstream>
 
 #include "cob_obstacle_distance/parsers/stl_parser.hpp"
 #include "cob_obstacle_distance/helpers/helper_functions.hpp"
 
+#define STL_HEADER_SIZE 80
+#define STL_BINARY_OFFSET 84  // header + uint32 number of triangles
+#define STL_FACET_SIZE 50  // normal, 3 vertices (12 floats) + uint16 attribute byte count
+#define STL_NORMAL_SIZE 12
+#define STL_VERTEX_SIZE 12
+
+/// Read-only memory mapping of a whole file. Unmapped on destruction.
+class MappedFile
+{
+    private:
+        int fd_;
+        void* data_;
+        size_t size_;
+
+    public:
+        explicit MappedFile(const std::string& file_path)
+        : fd_(-1), data_(MAP_FAILED), size_(0)
+        {
+            this->fd_ = open(file_path.c_str(), O_RDONLY);
+            struct stat st;
+            if (this->fd_ < 0 || 0 != fstat(this->fd_, &st) || st.st_size <= 0)
+            {
+                return;
+            }
+
+            this->size_ = static_cast<size_t>(st.st_size);
+            this->data_ = mmap(NULL, this->size_, PROT_READ, MAP_PRIVATE, this->fd_, 0);
+            if (MAP_FAILED != this->data_)
+            {
+                madvise(this->data_, this->size_, MADV_SEQUENTIAL);
+            }
+        }
+
+        ~MappedFile()
+        {
+            if (MAP_FAILED != this->data_)
+            {
+                munmap(this->data_, this->size_);
+            }
+
+            if (this->fd_ >= 0)
+            {
+                close(this->fd_);
+            }
+        }
+
+        inline bool isValid() const
+        {
+            return MAP_FAILED != this->data_;
+        }
+
+        inline const char* getData() const
+        {
+            return static_cast<const char*>(this->data_);
+        }
+
+        inline size_t getSize() const
+        {
+            return this->size_;
+        }
+};
+
+
 /**
- * Hard coded STL file parsing according to binary file specification in https://en.wikipedia.org/wiki/STL_%28file_format%29.
+ * Reads binary or ASCII STL files according to the file specification in https://en.wikipedia.org/wiki/STL_%28file_format%29.
+ * The file is memory-mapped; binary files are decoded in a single pass into pre-sized buffers.
  */
-int8_t StlParser::read(std::vector<TriangleSupport>& tri_vec)
+int8_t StlParser::read(std::vector<fcl::Vec3f>& vertices, std::vector<fcl::Triangle>& triangles)
 {
-    char header_info[80] = "";
-    char nTri[4];
-    uint32_t nTriLong;
-
     std::string file_path = this->file_path_;
     if (!boost::filesystem::exists(this->file_path_))
     {
         file_path = resolveURI(this->file_path_);
     }
 
-    std::ifstream myFile(
-        file_path.c_str(),
-        std::ios::in | std::ios::binary);
-
-    if (!myFile)
+    MappedFile file(file_path);
+    if (!file.isValid())
     {
         ROS_ERROR_STREAM("Could not read file: " << file_path);
         return -1;
     }
 
-    // read 80 byte header
-    myFile.read(header_info, 80);
-    ROS_DEBUG_STREAM("header: " << header_info);
+    // Binary files may also start with "solid" in their header, so the file size decides.
+    // Some exporters append data after the last facet, so the size only has to cover the announced facets.
+    bool is_binary = false;
+    if (file.getSize() >= STL_BINARY_OFFSET)
+    {
+        uint32_t num_tri;
+        std::memcpy(&num_tri, file.getData() + STL_HEADER_SIZE, sizeof(num_tri));
+        is_binary = (file.getSize() >= STL_BINARY_OFFSET + static_cast<size_t>(num_tri) * STL_FACET_SIZE);
+    }
+
+    if (is_binary || 0 != std::strncmp(file.getData(), "solid", std::min<size_t>(5, file.getSize())))
+    {
+        return this->readBinary(file.getData(), file.getSize(), vertices, triangles);
+    }
+
+    return this->readAscii(file.getData(), file.getSize(), vertices, triangles);
+}
+
+
+int8_t StlParser::readBinary(const char* data, size_t size, std::vector<fcl::Vec3f>& vertices, std::vector<fcl::Triangle>& triangles)
+{
+    if (size < STL_BINARY_OFFSET)
+    {
+        ROS_ERROR_STREAM("File is too small for a binary STL: " << this->file_path_);
+        return -2;
+    }
+
+    uint32_t num_tri;
+    std::memcpy(&num_tri, data + STL_HEADER_SIZE, sizeof(num_tri));
+    ROS_DEBUG_STREAM("Number of Triangles: " << num_tri);
+
+    if (size < STL_BINARY_OFFSET + static_cast<size_t>(num_tri) * STL_FACET_SIZE)
+    {
+        ROS_ERROR_STREAM("File is truncated. Expected " << num_tri << " triangles: " << this->file_path_);
+        return -2;
+    }
 
-    // read 4-byte ulong
-    myFile.read(nTri, 4);
-    nTriLong = *((uint32_t*) nTri);
-    ROS_DEBUG_STREAM("Number of Triangles: " << nTriLong);
+    VertexIndexMap_t index_map;
+    vertices.reserve(vertices.size() + (this->deduplicate_vertices_ ? num_tri / 2 : 3 * static_cast<size_t>(num_tri)));
+    triangles.reserve(triangles.size() + num_tri);
 
-    // now read in all the triangles
-    for (int i = 0; i < nTriLong; i++)
+    const char* facet = data + STL_BINARY_OFFSET;
+    for (uint32_t i = 0; i < num_tri; ++i, facet += STL_FACET_SIZE)
     {
-        char facet[50];
-        if (myFile)
-        {
-            // read one 50-byte triangle
-            myFile.read(facet, 50);
+        // facet + 12 skips the triangle's unit normal
+        const char* vertex = facet + STL_NORMAL_SIZE;
+        uint32_t a = this->addVertex(this->toVec3f(vertex), index_map, vertices);
+        uint32_t b = this->addVertex(this->toVec3f(vertex + STL_VERTEX_SIZE), index_map, vertices);
+        uint32_t c = this->addVertex(this->toVec3f(vertex + 2 * STL_VERTEX_SIZE), index_map, vertices);
+        triangles.push_back(fcl::Triangle(a, b, c));
+    }
 
-            // populate each point of the triangle
-            // facet + 12 skips the triangle's unit normal
+    return 0;
+}
 
-            TriangleSupport t;
-            t.a = this->toVec3f(facet + 12);
-            t.b = this->toVec3f(facet + 24);
-            t.c = this->toVec3f(facet + 36);
 
-            tri_vec.push_back(t);
+int8_t StlParser::readAscii(const char* data, size_t size, std::vector<fcl::Vec3f>& vertices, std::vector<fcl::Triangle>& triangles)
+{
+    // strtod needs a terminated buffer
+    const std::string content(data, size);
+    const char* cur = content.c_str();
+    const char* end = cur + content.size();
+
+    VertexIndexMap_t index_map;
+    uint32_t corner[3];
+    uint8_t num_corners = 0;
+    while (NULL != (cur = std::strstr(cur, "vertex")) && cur < end)
+    {
+        cur += 6;
+        char* next;
+        double xyz[3];
+        for (uint8_t j = 0; j < 3; ++j)
+        {
+            xyz[j] = std::strtod(cur, &next);
+            if (next == cur)
+            {
+                ROS_ERROR_STREAM("Malformed vertex in ASCII STL: " << this->file_path_);
+                return -3;
+            }
+
+            cur = next;
         }
-        else
+
+        corner[num_corners++] = this->addVertex(fcl::Vec3f(xyz[0], xyz[1], xyz[2]), index_map, vertices);
+        if (3 == num_corners)
         {
-            ROS_ERROR_STREAM("File handle is not valid anymore: " << file_path);
-            return -2;
+            triangles.push_back(fcl::Triangle(corner[0], corner[1], corner[2]));
+            num_corners = 0;
         }
     }
 
+    if (triangles.empty())
+    {
+        ROS_ERROR_STREAM("Found no triangles in ASCII STL: " << this->file_path_);
+        return -3;
+    }
+
+    ROS_DEBUG_STREAM("Number of Triangles: " << triangles.size());
     return 0;
 }
 
-/**
- * Converter method from position in file to a 3d vector.
- * @param facet Pointer to the current face / triangle in file.
- * @return An fcl::Vec3f containing the 3 vertices describing a triangle.
- */
-fcl::Vec3f StlParser::toVec3f(char* facet)
-{
-    double x = this->toDouble(facet, 0);
-    double y = this->toDouble(facet, 4);
-    double z = this->toDouble(facet, 8);
-
-    fcl::Vec3f v3(x, y, z);
-    return v3;
-}
 
 /**
- * Conversion of a 32 bit binary value into double.
- * @param facet Current face / triangle.
- * @param start_idx Index in binary face description.
- * @return Double value.
+ * Converter method from position in file to a 3d vector.
+ * @param facet Pointer to three little-endian 32 bit floats in the file.
+ * @return An fcl::Vec3f containing the vertex.
  */
-double StlParser::toDouble(char* facet, uint8_t start_idx)
+fcl::Vec3f StlParser::toVec3f(const char* facet) const
 {
-    char f1[4] = {  facet[start_idx],
-                    facet[start_idx + 1],
-                    facet[start_idx + 2],
-                    facet[start_idx + 3]};
-    float f_val = *((float*) f1);
-    double d_val = static_cast<double>(f_val);
-    return d_val;
+    float xyz[3];
+    std::memcpy(xyz, facet, sizeof(xyz));
+    return fcl::Vec3f(xyz[0], xyz[1], xyz[2]);
 }
-
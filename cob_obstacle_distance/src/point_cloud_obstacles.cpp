@@ -0,0 +1,168 @@
+/*
+ * Copyright 2017 Fraunhofer Institute for Manufacturing Engineering and Automation (IPA)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <cmath>
+#include <vector>
+
+#include <sensor_msgs/point_cloud2_iterator.h>
+
+#include "cob_obstacle_distance/point_cloud_obstacles.hpp"
+
+#define KEY_BITS 21
+#define KEY_OFFSET (1 << (KEY_BITS - 1))
+#define KEY_MASK ((1ULL << KEY_BITS) - 1)
+
+
+uint64_t PointCloudObstacles::toKey(int32_t x, int32_t y, int32_t z)
+{
+    return ((static_cast<uint64_t>(x + KEY_OFFSET) & KEY_MASK) << (2 * KEY_BITS)) |
+           ((static_cast<uint64_t>(y + KEY_OFFSET) & KEY_MASK) << KEY_BITS) |
+           (static_cast<uint64_t>(z + KEY_OFFSET) & KEY_MASK);
+}
+
+
+/**
+ * Inverse of PointCloudObstacles::toKey.
+ */
+static void fromKey(uint64_t key, int32_t& x, int32_t& y, int32_t& z)
+{
+    x = static_cast<int32_t>((key >> (2 * KEY_BITS)) & KEY_MASK) - KEY_OFFSET;
+    y = static_cast<int32_t>((key >> KEY_BITS) & KEY_MASK) - KEY_OFFSET;
+    z = static_cast<int32_t>(key & KEY_MASK) - KEY_OFFSET;
+}
+
+
+PointCloudObstacles::PointCloudObstacles(double voxel_size, double decay_time, double bucket_size)
+: voxel_size_(voxel_size),
+  decay_time_(decay_time),
+  bucket_size_(bucket_size),
+  snapshot_(new Snapshot())
+{}
+
+
+void PointCloudObstacles::insert(const sensor_msgs::PointCloud2& cloud, const tf::Transform& root_from_cloud)
+{
+    ros::WallTime start_time = ros::WallTime::now();
+    const ros::Time stamp = cloud.header.stamp.isZero() ? ros::Time::now() : cloud.header.stamp;
+    const double inv_voxel_size = 1.0 / this->voxel_size_;
+    const tf::Matrix3x3& rot = root_from_cloud.getBasis();
+    const tf::Vector3& trans = root_from_cloud.getOrigin();
+
+    // streaming downsampling: every point just refreshes the stamp of its voxel
+    uint32_t num_points = 0;
+    sensor_msgs::PointCloud2ConstIterator<float> it_x(cloud, "x");
+    sensor_msgs::PointCloud2ConstIterator<float> it_y(cloud, "y");
+    sensor_msgs::PointCloud2ConstIterator<float> it_z(cloud, "z");
+    for (; it_x != it_x.end(); ++it_x, ++it_y, ++it_z)
+    {
+        if (!std::isfinite(*it_x) || !std::isfinite(*it_y) || !std::isfinite(*it_z))
+        {
+            continue;
+        }
+
+        const tf::Vector3 p = rot * tf::Vector3(*it_x, *it_y, *it_z) + trans;
+        this->voxels_[toKey(static_cast<int32_t>(std::floor(p.x() * inv_voxel_size)),
+                            static_cast<int32_t>(std::floor(p.y() * inv_voxel_size)),
+                            static_cast<int32_t>(std::floor(p.z() * inv_voxel_size)))] = stamp;
+        ++num_points;
+    }
+
+    // time decay and new snapshot
+    std::shared_ptr<Snapshot> snapshot(new Snapshot());
+    snapshot->bucket_size_ = this->bucket_size_;
+    snapshot->voxel_size_ = this->voxel_size_;
+    snapshot->decay_time_ = this->decay_time_;
+    snapshot->points_.reserve(this->voxels_.size());
+    snapshot->stamps_.reserve(this->voxels_.size());
+    const ros::Time oldest = stamp.toSec() > this->decay_time_ ? stamp - ros::Duration(this->decay_time_) : ros::Time(0);
+    for (std::unordered_map<uint64_t, ros::Time>::iterator it = this->voxels_.begin(); it != this->voxels_.end();)
+    {
+        if (it->second < oldest)
+        {
+            it = this->voxels_.erase(it);
+            continue;
+        }
+
+        int32_t x, y, z;
+        fromKey(it->first, x, y, z);
+        const fcl::Vec3f center((x + 0.5) * this->voxel_size_, (y + 0.5) * this->voxel_size_, (z + 0.5) * this->voxel_size_);
+        snapshot->buckets_[toKey(static_cast<int32_t>(std::floor(center[0] / this->bucket_size_)),
+                                 static_cast<int32_t>(std::floor(center[1] / this->bucket_size_)),
+                                 static_cast<int32_t>(std::floor(center[2] / this->bucket_size_)))].push_back(snapshot->points_.size());
+        snapshot->points_.push_back(center);
+        snapshot->stamps_.push_back(it->second);
+        ++it;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(this->snapshot_mtx_);
+        this->snapshot_ = snapshot;
+    }
+
+    const double duration = (ros::WallTime::now() - start_time).toSec();
+    ROS_DEBUG_STREAM("PointCloudObstacles: Inserted " << num_points << " points into " << snapshot->points_.size() <<
+                     " occupied voxels in " << duration * 1000.0 << " ms (" <<
+                     (duration > 0.0 ? num_points / duration : 0.0) << " points/s).");
+}
+
+
+std::shared_ptr<const PointCloudObstacles::Snapshot> PointCloudObstacles::getSnapshot()
+{
+    std::lock_guard<std::mutex> lock(this->snapshot_mtx_);
+    return this->snapshot_;
+}
+
+
+void PointCloudObstacles::Snapshot::getPointsWithin(const fcl::AABB& box, const ros::Time& now, std::vector<uint32_t>& indices) const
+{
+    indices.clear();
+    if (this->points_.empty())
+    {
+        return;
+    }
+
+    const ros::Time oldest = now.toSec() > this->decay_time_ ? now - ros::Duration(this->decay_time_) : ros::Time(0);
+    int32_t lower[3], upper[3];
+    for (uint8_t a = 0; a < 3; ++a)
+    {
+        lower[a] = static_cast<int32_t>(std::floor(box.min_[a] / this->bucket_size_));
+        upper[a] = static_cast<int32_t>(std::floor(box.max_[a] / this->bucket_size_));
+    }
+
+    for (int32_t x = lower[0]; x <= upper[0]; ++x)
+    {
+        for (int32_t y = lower[1]; y <= upper[1]; ++y)
+        {
+            for (int32_t z = lower[2]; z <= upper[2]; ++z)
+            {
+                std::unordered_map<uint64_t, std::vector<uint32_t> >::const_iterator bucket = this->buckets_.find(toKey(x, y, z));
+                if (bucket == this->buckets_.end())
+                {
+                    continue;
+                }
+
+                for (std::vector<uint32_t>::const_iterator it = bucket->second.begin(); it != bucket->second.end(); ++it)
+                {
+                    if (this->stamps_[*it] >= oldest && box.contain(this->points_[*it]))
+                    {
+                        indices.push_back(*it);
+                    }
+                }
+            }
+        }
+    }
+}
@@ -16,9 +16,11 @@
 
 
 #include <string>
+#include <vector>
+#include <fcl/shape/geometric_shapes.h>
 #include "cob_obstacle_distance/shapes_manager.hpp"
 
-ShapesManager::ShapesManager(const ros::Publisher& pub) : pub_(pub)
+ShapesManager::ShapesManager(const ros::Publisher& pub) : broadphase_changed_(false), pub_(pub)
 {
 }
 
@@ -31,7 +33,9 @@ ShapesManager::~ShapesManager()
 
 void ShapesManager::addShape(const std::string& id, PtrIMarkerShape_t s)
 {
+    this->unregisterBroadphase(id);
     this->shapes_[id] = s;
+    this->registerBroadphase(id);
 }
 
 
@@ -42,9 +46,10 @@ void ShapesManager::removeShape(const std::string& id)
         PtrIMarkerShape_t s = this->shapes_[id];
         visualization_msgs::Marker marker = s->getMarker();
         marker.action = visualization_msgs::Marker::DELETE;
-        this->pub_.publish(marker);
+        this->deleted_markers_.push_back(marker);
     }
 
+    this->unregisterBroadphase(id);
     this->shapes_.erase(id);
 }
 
@@ -65,6 +70,7 @@ bool ShapesManager::getShape(const std::string& id, PtrIMarkerShape_t& s)
 void ShapesManager::draw()
 {
     visualization_msgs::MarkerArray marker_array;
+    marker_array.markers.swap(this->deleted_markers_);
     for (MapIter_t iter = shapes_.begin(); iter != shapes_.end(); ++iter)
     {
         PtrIMarkerShape_t elem = iter->second;
@@ -82,6 +88,9 @@ void ShapesManager::draw()
 
 void ShapesManager::clear()
 {
+    this->broadphase_.clear();
+    this->broadphase_changed_ = false;
+    this->deleted_markers_.clear();
     this->shapes_.clear();
 }
 
@@ -96,3 +105,92 @@ uint32_t ShapesManager::count(const std::string& id) const
 {
     return this->shapes_.count(id);
 }
+
+
+void ShapesManager::registerBroadphase(const std::string& id)
+{
+    MapIter_t it = this->shapes_.find(id);
+    if (it != this->shapes_.end())
+    {
+        // the map key is stable as long as the shape is managed
+        fcl::CollisionObject& collision_object = it->second->getCollisionObject();
+        collision_object.setUserData(const_cast<std::string*>(&it->first));
+        it->second->resetMoved();
+        this->broadphase_.registerObject(&collision_object);
+        this->broadphase_changed_ = true;
+    }
+}
+
+
+void ShapesManager::unregisterBroadphase(const std::string& id)
+{
+    MapIter_t it = this->shapes_.find(id);
+    if (it != this->shapes_.end())
+    {
+        this->broadphase_.unregisterObject(&it->second->getCollisionObject());
+        this->broadphase_changed_ = true;
+    }
+}
+
+
+void ShapesManager::updateBroadphase()
+{
+    std::vector<fcl::CollisionObject*> moved_objects;
+    for (MapIter_t iter = this->shapes_.begin(); iter != this->shapes_.end(); ++iter)
+    {
+        if (iter->second->hasMoved())
+        {
+            // transform and AABB have already been updated in place by the shape
+            moved_objects.push_back(&iter->second->getCollisionObject());
+            iter->second->resetMoved();
+        }
+    }
+
+    if (this->broadphase_changed_)
+    {
+        this->broadphase_.setup();
+        this->broadphase_changed_ = false;
+    }
+
+    if (!moved_objects.empty())
+    {
+        this->broadphase_.update(moved_objects);
+    }
+}
+
+
+bool ShapesManager::collectCandidates(fcl::CollisionObject* o1, fcl::CollisionObject* o2, void* cdata)
+{
+    std::vector<std::string>* ids = static_cast<std::vector<std::string>*>(cdata);
+
+    // the query object does not carry an id
+    const std::string* id = static_cast<const std::string*>(o1->getUserData() ? o1->getUserData() : o2->getUserData());
+    if (NULL != id)
+    {
+        ids->push_back(*id);
+    }
+
+    return false;  // continue to collect all candidates
+}
+
+
+void ShapesManager::getCandidates(const fcl::AABB& aabb, double max_distance, std::vector<std::string>& ids)
+{
+    ids.clear();
+
+    fcl::AABB query_aabb(aabb);
+    query_aabb.expand(fcl::Vec3f(max_distance, max_distance, max_distance));
+
+    std::shared_ptr<fcl::Box> query_box(new fcl::Box(query_aabb.width(), query_aabb.height(), query_aabb.depth()));
+    fcl::CollisionObject query_obj(query_box, fcl::Transform3f(query_aabb.center()));
+    query_obj.setUserData(NULL);
+
+    this->broadphase_.collide(&query_obj, &ids, &ShapesManager::collectCandidates);
+}
+
+
+fcl::CollisionObject* ShapesManager::getCollisionObject(const std::string& id)
+{
+    MapIter_t it = this->shapes_.find(id);
+    return (it != this->shapes_.end()) ? &it->second->getCollisionObject() : NULL;
+}
@@ -0,0 +1,406 @@
+/*
+ * Copyright 2017 Fraunhofer Institute for Manufacturing Engineering and Automation (IPA)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <ros/ros.h>
+
+#include "cob_obstacle_distance/static_distance_field.hpp"
+#include "cob_obstacle_distance/marker_shapes/marker_shapes_interface.hpp"
+
+#define EDT_INF 1e20
+
+
+StaticDistanceField::StaticDistanceField(double resolution, double margin)
+: resolution_(resolution),
+  margin_(margin),
+  next_generation_(0),
+  stop_builder_(false)
+{
+    this->builder_ = std::thread(&StaticDistanceField::buildLoop, this);
+}
+
+
+StaticDistanceField::~StaticDistanceField()
+{
+    {
+        std::lock_guard<std::mutex> lock(build_mtx_);
+        this->stop_builder_ = true;
+    }
+
+    this->build_cv_.notify_all();
+    this->builder_.join();
+}
+
+
+bool StaticDistanceField::setObstacle(const std::string& id, const fcl::CollisionObject& collision_object)
+{
+    const BVH_RSS_t* bvh = dynamic_cast<const BVH_RSS_t*>(collision_object.collisionGeometry().get());
+    if (NULL == bvh || bvh->num_tris <= 0)
+    {
+        ROS_WARN_STREAM("StaticDistanceField: Obstacle " << id << " has no triangle mesh and cannot be added.");
+        this->removeObstacle(id);
+        return false;
+    }
+
+    // Sample the triangles densely enough that every surface voxel is hit.
+    const fcl::Transform3f& tf = collision_object.getTransform();
+    const double sample_spacing = 0.5 * this->resolution_;
+    Obstacle& obstacle = this->pending_[id];
+    obstacle.generation_ = ++this->next_generation_;
+    this->generations_[id] = obstacle.generation_;
+    std::vector<VoxelKey>& keys = obstacle.voxels_;
+    keys.clear();
+    for (int i = 0; i < bvh->num_tris; ++i)
+    {
+        const fcl::Triangle& tri = bvh->tri_indices[i];
+        const fcl::Vec3f a = tf.transform(bvh->vertices[tri[0]]);
+        const fcl::Vec3f ab = tf.transform(bvh->vertices[tri[1]]) - a;
+        const fcl::Vec3f ac = tf.transform(bvh->vertices[tri[2]]) - a;
+        const double max_edge = std::max(std::max(ab.length(), ac.length()), (ac - ab).length());
+        const int32_t n = std::max(1, static_cast<int32_t>(std::ceil(max_edge / sample_spacing)));
+        for (int32_t u = 0; u <= n; ++u)
+        {
+            for (int32_t v = 0; v <= n - u; ++v)
+            {
+                const fcl::Vec3f p = a + ab * (static_cast<double>(u) / n) + ac * (static_cast<double>(v) / n);
+                VoxelKey key;
+                key.x_ = static_cast<int32_t>(std::floor(p[0] / this->resolution_));
+                key.y_ = static_cast<int32_t>(std::floor(p[1] / this->resolution_));
+                key.z_ = static_cast<int32_t>(std::floor(p[2] / this->resolution_));
+                keys.push_back(key);
+            }
+        }
+    }
+
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    return true;
+}
+
+
+void StaticDistanceField::removeObstacle(const std::string& id)
+{
+    this->generations_.erase(id);
+    this->pending_.erase(id);
+}
+
+
+bool StaticDistanceField::contains(const std::string& id) const
+{
+    std::unordered_map<std::string, uint32_t>::const_iterator it = this->generations_.find(id);
+    Grids_t::const_iterator grid_it = this->grids_.find(id);
+    return it != this->generations_.end() && grid_it != this->grids_.end() &&
+           it->second == grid_it->second->generation_;
+}
+
+
+void StaticDistanceField::update()
+{
+    std::lock_guard<std::mutex> lock(build_mtx_);
+    for (Grids_t::iterator it = this->built_.begin(); it != this->built_.end(); ++it)
+    {
+        this->grids_[it->first] = it->second;
+    }
+
+    this->built_.clear();
+
+    // grids of removed obstacles are dropped, grids of outdated versions are kept until their rebuild is done
+    for (Grids_t::iterator it = this->grids_.begin(); it != this->grids_.end();)
+    {
+        if (this->generations_.count(it->first) == 0)
+        {
+            it = this->grids_.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    if (!this->pending_.empty())
+    {
+        // only the changed obstacles are rebuilt, an obstacle that changed again replaces its older pending version
+        for (Obstacles_t::iterator it = this->pending_.begin(); it != this->pending_.end(); ++it)
+        {
+            this->build_input_[it->first].voxels_.swap(it->second.voxels_);
+            this->build_input_[it->first].generation_ = it->second.generation_;
+        }
+
+        this->pending_.clear();
+        this->build_cv_.notify_one();
+    }
+}
+
+
+void StaticDistanceField::buildLoop()
+{
+    while (true)
+    {
+        Obstacles_t obstacles;
+        {
+            std::unique_lock<std::mutex> lock(build_mtx_);
+            this->build_cv_.wait(lock, [this] { return this->stop_builder_ || !this->build_input_.empty(); });
+            if (this->stop_builder_)
+            {
+                return;
+            }
+
+            obstacles.swap(this->build_input_);
+        }
+
+        for (Obstacles_t::const_iterator it = obstacles.begin(); it != obstacles.end(); ++it)
+        {
+            std::shared_ptr<const Grid> grid = this->build(it->second);
+
+            std::lock_guard<std::mutex> lock(build_mtx_);
+            this->built_[it->first] = grid;
+            if (this->stop_builder_)
+            {
+                return;
+            }
+        }
+    }
+}
+
+
+std::shared_ptr<const StaticDistanceField::Grid> StaticDistanceField::build(const Obstacle& obstacle) const
+{
+    ros::WallTime start_time = ros::WallTime::now();
+    std::shared_ptr<Grid> grid(new Grid());
+    grid->generation_ = obstacle.generation_;
+
+    // bounds of the surface voxels plus the margin
+    VoxelKey min_key, max_key;
+    min_key.x_ = min_key.y_ = min_key.z_ = std::numeric_limits<int32_t>::max();
+    max_key.x_ = max_key.y_ = max_key.z_ = std::numeric_limits<int32_t>::min();
+    for (std::vector<VoxelKey>::const_iterator k = obstacle.voxels_.begin(); k != obstacle.voxels_.end(); ++k)
+    {
+        min_key.x_ = std::min(min_key.x_, k->x_);
+        min_key.y_ = std::min(min_key.y_, k->y_);
+        min_key.z_ = std::min(min_key.z_, k->z_);
+        max_key.x_ = std::max(max_key.x_, k->x_);
+        max_key.y_ = std::max(max_key.y_, k->y_);
+        max_key.z_ = std::max(max_key.z_, k->z_);
+    }
+
+    // points beyond the outermost voxel centers are more than the margin away from the surface
+    const int32_t pad = static_cast<int32_t>(std::ceil(this->margin_ / this->resolution_)) + 1;
+    grid->origin_.x_ = min_key.x_ - pad;
+    grid->origin_.y_ = min_key.y_ - pad;
+    grid->origin_.z_ = min_key.z_ - pad;
+    grid->size_[0] = max_key.x_ - min_key.x_ + 1 + 2 * pad;
+    grid->size_[1] = max_key.y_ - min_key.y_ + 1 + 2 * pad;
+    grid->size_[2] = max_key.z_ - min_key.z_ + 1 + 2 * pad;
+    const size_t num_voxels = static_cast<size_t>(grid->size_[0]) * grid->size_[1] * grid->size_[2];
+
+    // surface voxels are the sites of the distance transform
+    std::vector<uint8_t> site(num_voxels, 0);
+    for (std::vector<VoxelKey>::const_iterator k = obstacle.voxels_.begin(); k != obstacle.voxels_.end(); ++k)
+    {
+        site[grid->index(k->x_ - grid->origin_.x_, k->y_ - grid->origin_.y_, k->z_ - grid->origin_.z_)] = 1;
+    }
+
+    // flood fill from the (free) grid corner: free voxels that cannot be reached lie inside the obstacle
+    std::vector<uint8_t> outside(num_voxels, 0);
+    std::deque<size_t> queue;
+    outside[0] = 1;
+    queue.push_back(0);
+    const size_t stride_y = grid->size_[0];
+    const size_t stride_z = stride_y * grid->size_[1];
+    while (!queue.empty())
+    {
+        const size_t idx = queue.front();
+        queue.pop_front();
+        const int32_t x = idx % grid->size_[0];
+        const int32_t y = (idx / stride_y) % grid->size_[1];
+        const int32_t z = idx / stride_z;
+        const size_t neighbors[6] = {idx - 1, idx + 1, idx - stride_y, idx + stride_y, idx - stride_z, idx + stride_z};
+        const bool valid[6] = {x > 0, x < grid->size_[0] - 1, y > 0, y < grid->size_[1] - 1, z > 0, z < grid->size_[2] - 1};
+        for (uint8_t n = 0; n < 6; ++n)
+        {
+            if (valid[n] && !outside[neighbors[n]] && !site[neighbors[n]])
+            {
+                outside[neighbors[n]] = 1;
+                queue.push_back(neighbors[n]);
+            }
+        }
+    }
+
+    // separable exact EDT to the surface voxels, one pass per axis
+    std::vector<double> f(num_voxels);
+    for (size_t i = 0; i < num_voxels; ++i)
+    {
+        f[i] = site[i] ? 0.0 : EDT_INF;
+    }
+
+    const int32_t max_size = std::max(grid->size_[0], std::max(grid->size_[1], grid->size_[2]));
+    std::vector<double> line_f(max_size), z_buf(max_size + 1);
+    std::vector<int32_t> v_buf(max_size);
+    for (int32_t z = 0; z < grid->size_[2]; ++z)
+    {
+        for (int32_t y = 0; y < grid->size_[1]; ++y)
+        {
+            transformLine(f, grid->index(0, y, z), 1, grid->size_[0], line_f, v_buf, z_buf);
+        }
+    }
+
+    for (int32_t z = 0; z < grid->size_[2]; ++z)
+    {
+        for (int32_t x = 0; x < grid->size_[0]; ++x)
+        {
+            transformLine(f, grid->index(x, 0, z), stride_y, grid->size_[1], line_f, v_buf, z_buf);
+        }
+    }
+
+    for (int32_t y = 0; y < grid->size_[1]; ++y)
+    {
+        for (int32_t x = 0; x < grid->size_[0]; ++x)
+        {
+            transformLine(f, grid->index(x, y, 0), stride_z, grid->size_[2], line_f, v_buf, z_buf);
+        }
+    }
+
+    grid->distance_.resize(num_voxels);
+    for (size_t i = 0; i < num_voxels; ++i)
+    {
+        const double d = std::sqrt(f[i]) * this->resolution_;
+        grid->distance_[i] = static_cast<float>((outside[i] || site[i]) ? d : -d);
+    }
+
+    ROS_DEBUG_STREAM("StaticDistanceField: Rebuilt " << grid->size_[0] << "x" << grid->size_[1] << "x" << grid->size_[2] <<
+                     " grid in " << (ros::WallTime::now() - start_time).toSec() * 1000.0 << " ms.");
+    return grid;
+}
+
+
+void StaticDistanceField::transformLine(std::vector<double>& f, size_t offset, size_t stride, int32_t n,
+                                        std::vector<double>& line_f, std::vector<int32_t>& v, std::vector<double>& z)
+{
+    for (int32_t q = 0; q < n; ++q)
+    {
+        line_f[q] = f[offset + q * stride];
+    }
+
+    // lower envelope of the parabolas rooted at each sample
+    int32_t k = 0;
+    v[0] = 0;
+    z[0] = -EDT_INF;
+    z[1] = EDT_INF;
+    for (int32_t q = 1; q < n; ++q)
+    {
+        double s = ((line_f[q] + q * q) - (line_f[v[k]] + v[k] * v[k])) / (2.0 * (q - v[k]));
+        while (k > 0 && s <= z[k])
+        {
+            --k;
+            s = ((line_f[q] + q * q) - (line_f[v[k]] + v[k] * v[k])) / (2.0 * (q - v[k]));
+        }
+
+        ++k;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = EDT_INF;
+    }
+
+    k = 0;
+    for (int32_t q = 0; q < n; ++q)
+    {
+        while (z[k + 1] < q)
+        {
+            ++k;
+        }
+
+        f[offset + q * stride] = (q - v[k]) * (q - v[k]) + line_f[v[k]];
+    }
+}
+
+
+bool StaticDistanceField::query(const std::string& id, const fcl::Vec3f& p, double& distance, fcl::Vec3f& gradient) const
+{
+    Grids_t::const_iterator grid_it = this->grids_.find(id);
+    if (this->grids_.end() == grid_it)
+    {
+        return false;
+    }
+
+    const Grid* grid = grid_it->second.get();
+
+    // continuous grid coordinates with the voxel centers at integer values
+    const double u[3] = {p[0] / this->resolution_ - 0.5 - grid->origin_.x_,
+                         p[1] / this->resolution_ - 0.5 - grid->origin_.y_,
+                         p[2] / this->resolution_ - 0.5 - grid->origin_.z_};
+    int32_t i[3];
+    double t[3];
+    for (uint8_t a = 0; a < 3; ++a)
+    {
+        if (u[a] < 0.0 || u[a] >= grid->size_[a] - 1)
+        {
+            return false;
+        }
+
+        i[a] = static_cast<int32_t>(u[a]);
+        t[a] = u[a] - i[a];
+    }
+
+    double c[2][2][2];
+    for (uint8_t dx = 0; dx < 2; ++dx)
+    {
+        for (uint8_t dy = 0; dy < 2; ++dy)
+        {
+            for (uint8_t dz = 0; dz < 2; ++dz)
+            {
+                c[dx][dy][dz] = grid->distance_[grid->index(i[0] + dx, i[1] + dy, i[2] + dz)];
+            }
+        }
+    }
+
+    const double c00 = c[0][0][0] * (1 - t[0]) + c[1][0][0] * t[0];
+    const double c10 = c[0][1][0] * (1 - t[0]) + c[1][1][0] * t[0];
+    const double c01 = c[0][0][1] * (1 - t[0]) + c[1][0][1] * t[0];
+    const double c11 = c[0][1][1] * (1 - t[0]) + c[1][1][1] * t[0];
+    const double c0 = c00 * (1 - t[1]) + c10 * t[1];
+    const double c1 = c01 * (1 - t[1]) + c11 * t[1];
+
+    // The trilinear value may overestimate: each corner only bounds the distance at its center (d - |p - c| by the
+    // Lipschitz property) and the sites are voxel centers, the surface may be up to half a voxel diagonal closer.
+    distance = -0.5 * std::sqrt(3.0) * this->resolution_;
+    for (uint8_t dx = 0; dx < 2; ++dx)
+    {
+        for (uint8_t dy = 0; dy < 2; ++dy)
+        {
+            for (uint8_t dz = 0; dz < 2; ++dz)
+            {
+                const double w = (dx ? t[0] : 1 - t[0]) * (dy ? t[1] : 1 - t[1]) * (dz ? t[2] : 1 - t[2]);
+                const double offset = std::sqrt((t[0] - dx) * (t[0] - dx) + (t[1] - dy) * (t[1] - dy) + (t[2] - dz) * (t[2] - dz));
+                distance += w * (c[dx][dy][dz] - offset * this->resolution_);
+            }
+        }
+    }
+
+    // analytic derivative of the trilinear interpolation
+    const double ddx = ((c[1][0][0] - c[0][0][0]) * (1 - t[1]) * (1 - t[2]) + (c[1][1][0] - c[0][1][0]) * t[1] * (1 - t[2]) +
+                        (c[1][0][1] - c[0][0][1]) * (1 - t[1]) * t[2] + (c[1][1][1] - c[0][1][1]) * t[1] * t[2]);
+    const double ddy = ((c10 - c00) * (1 - t[2]) + (c11 - c01) * t[2]);
+    const double ddz = c1 - c0;
+    gradient.setValue(ddx / this->resolution_, ddy / this->resolution_, ddz / this->resolution_);
+    return true;
+}
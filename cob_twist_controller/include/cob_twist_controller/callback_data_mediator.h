@@ -18,6 +18,8 @@
 #ifndef COB_TWIST_CONTROLLER_CALLBACK_DATA_MEDIATOR_H
 #define COB_TWIST_CONTROLLER_CALLBACK_DATA_MEDIATOR_H
 
+#include <map>
+#include <string>
 #include <vector>
 #include <stdint.h>
 #include <boost/thread/mutex.hpp>
@@ -25,6 +27,8 @@
 #include "cob_twist_controller/cob_twist_controller_data_types.h"
 #include "cob_twist_controller/constraints/constraint_params.h"
 #include "cob_control_msgs/ObstacleDistances.h"
+#include "cob_control_msgs/CompactObstacleDistances.h"
+#include "cob_control_msgs/ObstacleDistanceNames.h"
 
 /// Represents a data pool for distribution of collected data from ROS callback.
 class CallbackDataMediator
@@ -34,8 +38,20 @@ class CallbackDataMediator
         ObstacleDistancesInfo_t obstacle_distances_;
         boost::mutex distances_to_obstacles_lock_;
 
+        std::vector<std::string> compact_links_;  ///< link name table of the compact distances
+        uint32_t compact_names_version_;
+        uint32_t compact_sequence_;  ///< sequence number of the last applied message
+        bool compact_names_valid_;  ///< false until a name table has been received
+        bool compact_synced_;  ///< false if a delta could not be applied, then the next keyframe is awaited
+        std::map<uint32_t, ObstacleDistanceData> compact_distances_;  ///< first: link index << 16 | obstacle index
+
     public:
-        CallbackDataMediator() {}
+        CallbackDataMediator()
+        : compact_names_version_(0),
+          compact_sequence_(0),
+          compact_names_valid_(false),
+          compact_synced_(false)
+        {}
 
         /**
          * @return Number of active distances to obstacles.
@@ -61,6 +77,19 @@ class CallbackDataMediator
          * @param msg The published message containting obstacle distances.
          */
         void distancesToObstaclesCallback(const cob_control_msgs::ObstacleDistances::ConstPtr& msg);
+
+        /**
+         * Callback method for the name table of the compact obstacle distances.
+         * @param msg The published (latched) name table.
+         */
+        void distanceNamesCallback(const cob_control_msgs::ObstacleDistanceNames::ConstPtr& msg);
+
+        /**
+         * Callback method for the compact, delta encoded obstacle distances.
+         * Deltas are applied to the last known distances; after a gap the next keyframe is awaited.
+         * @param msg The published message containing the new, changed and released pairs.
+         */
+        void compactDistancesToObstaclesCallback(const cob_control_msgs::CompactObstacleDistances::ConstPtr& msg);
 };
 
 #endif  // COB_TWIST_CONTROLLER_CALLBACK_DATA_MEDIATOR_H
@@ -64,6 +64,8 @@ private:
 
     ros::ServiceClient register_link_client_;
     ros::Subscriber obstacle_distance_sub_;
+    ros::Subscriber obstacle_distance_names_sub_;
+    ros::Subscriber compact_obstacle_distance_sub_;
 
     KDL::Chain chain_;
     JointStates joint_states_;
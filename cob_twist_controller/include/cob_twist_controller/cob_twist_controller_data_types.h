@@ -136,6 +136,8 @@ struct ObstacleDistanceData
     Eigen::Vector3d frame_vector;
     Eigen::Vector3d nearest_point_frame_vector;
     Eigen::Vector3d nearest_point_obstacle_vector;
+    bool contact_predicted;  ///< contact at the current velocity within the prediction horizon
+    double time_to_contact;  ///< [s] until contact, only valid if contact_predicted
 };
 
 struct ConstraintThresholds
@@ -226,6 +228,8 @@ struct TwistControllerParams
         solver(GPM),
         priority_main(500),
         k_H(1.0),
+        prediction_horizon(1),
+        prediction_budget(0.001),
 
         constraint_jla(JLA_ON),
         constraint_ca(CA_ON),
@@ -272,6 +276,8 @@ struct TwistControllerParams
     SolverTypes solver;
     uint32_t priority_main;
     double k_H;
+    uint16_t prediction_horizon;
+    double prediction_budget;
 
     ConstraintTypesCA constraint_ca;
     ConstraintTypesJLA constraint_jla;
@@ -306,6 +312,8 @@ struct TwistControllerParams
         solver = static_cast<SolverTypes>(config.solver);
         priority_main = config.priority;
         k_H = config.k_H;
+        prediction_horizon = config.prediction_horizon;
+        prediction_budget = config.prediction_budget / 1000.0;  // in [s]
 
         constraint_jla = static_cast<ConstraintTypesJLA>(config.constraint_jla);
         constraint_ca = static_cast<ConstraintTypesCA>(config.constraint_ca);
@@ -367,6 +375,8 @@ struct TwistControllerParams
         config.solver = solver;
         config.priority = priority_main;
         config.k_H = k_H;
+        config.prediction_horizon = prediction_horizon;
+        config.prediction_budget = prediction_budget * 1000.0;
 
         config.constraint_jla = config.constraint_jla;
         config.constraint_ca = constraint_ca;
@@ -26,6 +26,7 @@
 
 #include "cob_twist_controller/constraints/constraint_base.h"
 #include "cob_twist_controller/constraints/constraint.h"
+#include "cob_twist_controller/utils/lookahead_predictor.h"
 
 #define START_CNT 40.0
 
@@ -65,6 +66,7 @@ class StackOfTasksSolver : public ConstraintSolver<>
         ros::Time last_time_;
         EN_ConstraintStates global_constraint_state_;
         double in_cart_vel_damping_;
+        LookaheadPredictor lookahead_predictor_;
 };
 
 #endif  // COB_TWIST_CONTROLLER_CONSTRAINT_SOLVERS_SOLVERS_STACK_OF_TASKS_SOLVER_H
@@ -81,6 +81,11 @@ class CollisionAvoidance : public ConstraintBase<T_PARAMS, PRIO>
     private:
         virtual double getCriticalValue() const;
 
+        /**
+         * @return True if the obstacle distance node predicts a contact of the link within its horizon.
+         */
+        bool isContactPredicted() const;
+
         void calcValue();
         void calcDerivativeValue();
         void calcPartialValues();
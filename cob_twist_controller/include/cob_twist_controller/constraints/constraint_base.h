@@ -84,11 +84,13 @@ class PriorityBase
         virtual Eigen::VectorXd getTaskDerivatives() const = 0;
 
         virtual void update(const JointStates& joint_states, const KDL::JntArrayVel& joints_prediction, const Matrix6Xd_t& jacobian_data) = 0;
+        virtual void setPredictionSteps(uint16_t steps) = 0;
         virtual void calculate() = 0;
         virtual double getValue() const = 0;
         virtual double getDerivativeValue() const = 0;
         virtual Eigen::VectorXd getPartialValues() const = 0;
         virtual double getPredictionValue() const = 0;
+        virtual double getPredictionDuration() const = 0;
 
         virtual double getActivationGain() const = 0;
         virtual double getSelfMotionMagnitude(const Eigen::MatrixXd& particular_solution,
@@ -125,6 +127,8 @@ class ConstraintBase : public PriorityBase<PRIO>
           value_(0.0),
           derivative_value_(0.0),
           prediction_value_(std::numeric_limits<double>::max()),
+          prediction_steps_(1),
+          prediction_duration_(0.0),
           last_value_(0.0),
           last_time_(ros::Time::now()),
           last_pred_time_(ros::Time::now())
@@ -174,6 +178,14 @@ class ConstraintBase : public PriorityBase<PRIO>
             this->calculate();
         }
 
+        /**
+         * @param steps Number of solver cycles the joints prediction lies ahead of the current joint states.
+         */
+        virtual void setPredictionSteps(uint16_t steps)
+        {
+            this->prediction_steps_ = steps > 0 ? steps : 1;
+        }
+
         virtual void calculate() = 0;
 
         virtual double getValue() const
@@ -196,6 +208,14 @@ class ConstraintBase : public PriorityBase<PRIO>
             return this->prediction_value_;
         }
 
+        /**
+         * @return Measured duration of the lookahead steps of the last update in [s] (the part that scales with the prediction steps).
+         */
+        virtual double getPredictionDuration() const
+        {
+            return this->prediction_duration_;
+        }
+
         virtual double getActivationGain() const = 0;
         virtual double getSelfMotionMagnitude(const Eigen::MatrixXd& particular_solution,
                                               const Eigen::MatrixXd& homogeneous_solution) const = 0;
@@ -213,6 +233,8 @@ class ConstraintBase : public PriorityBase<PRIO>
         double derivative_value_;
         Eigen::VectorXd partial_values_;
         double prediction_value_;
+        uint16_t prediction_steps_;
+        double prediction_duration_;
         double last_value_;
         ros::Time last_time_;
         ros::Time last_pred_time_;
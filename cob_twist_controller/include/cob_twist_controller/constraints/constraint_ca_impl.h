@@ -95,7 +95,7 @@ void CollisionAvoidance<T_PARAMS, PRIO>::calculate()
     {
         ROS_WARN_STREAM(this->getTaskId() << ": Current state is CRITICAL but prediction " << pred_min_dist << " is smaller than current dist " << crit_min_distance << " -> Stay in CRIT.");
     }
-    else if (crit_min_distance < critical || pred_min_dist < critical)
+    else if (crit_min_distance < critical || pred_min_dist < critical || this->isContactPredicted())
     {
         this->state_.setState(CRITICAL);
     }
@@ -187,6 +187,22 @@ double CollisionAvoidance<T_PARAMS, PRIO>::getCriticalValue() const
     return min_distance;
 }
 
+template <typename T_PARAMS, typename PRIO>
+bool CollisionAvoidance<T_PARAMS, PRIO>::isContactPredicted() const
+{
+    for (std::vector<ObstacleDistanceData>::const_iterator it = this->constraint_params_.current_distances_.begin();
+         it != this->constraint_params_.current_distances_.end();
+         ++it)
+    {
+        if (it->contact_predicted)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 template <typename T_PARAMS, typename PRIO>
 void CollisionAvoidance<T_PARAMS, PRIO>::calcValue()
 {
@@ -345,6 +361,7 @@ void CollisionAvoidance<T_PARAMS, PRIO>::calcPredictionValue()
 {
     const ConstraintParams& params = this->constraint_params_.params_;
     this->prediction_value_ = std::numeric_limits<double>::max();
+    this->prediction_duration_ = 0.0;
 
     ros::Time now = ros::Time::now();
     double cycle = (now - this->last_pred_time_).toSec();
@@ -360,39 +377,66 @@ void CollisionAvoidance<T_PARAMS, PRIO>::calcPredictionValue()
         if (this->constraint_params_.current_distances_.size() > 0)
         {
             uint32_t frame_number = (str_it - this->constraint_params_.frame_names_.begin()) + 1;  // segment nr not index represents frame number
-            KDL::FrameVel frame_vel;
 
-            // Calculate prediction for pos and vel
-            int error = this->fk_solver_vel_.JntToCart(this->jnts_prediction_, frame_vel, frame_number);
+            std::vector<ObstacleDistanceData>::const_iterator it = this->constraint_params_.current_distances_.begin();
+            ObstacleDistanceData critical_data = *it;
+            for ( ; it != this->constraint_params_.current_distances_.end(); ++it)
+            {
+                if (it->min_distance < critical_data.min_distance)
+                {
+                    critical_data = *it;
+                }
+            }
+
+            // Roll the critical point forward over the prediction horizon: the frame twist is evaluated by FK at the
+            // current and at the predicted joint positions only and interpolated in between, the point itself is
+            // advanced incrementally by the twist of each step.
+            const uint16_t steps = this->prediction_steps_;
+            KDL::JntArrayVel jnts_current(this->jnts_prediction_.q.rows());
+            for (uint32_t i = 0; i < jnts_current.q.rows(); ++i)
+            {
+                jnts_current.q(i) = this->joint_states_.current_q_(i);
+            }
+
+            jnts_current.qdot = this->jnts_prediction_.qdot;
+
+            KDL::FrameVel frame_vel_current, frame_vel_predicted;
+            int error = this->fk_solver_vel_.JntToCart(jnts_current, frame_vel_current, frame_number);
+            if (error == 0)
+            {
+                error = this->fk_solver_vel_.JntToCart(this->jnts_prediction_, frame_vel_predicted, frame_number);
+            }
+
             if (error != 0)
             {
                 ROS_ERROR_STREAM("Could not calculate twist for frame: " << frame_number << ". Error Code: " << error << " (" << this->fk_solver_vel_.strError(error) << ")");
                 ROS_ERROR_STREAM("This is likely due to using a KinematicExtension! The ChainFkSolverVel is configured for the main chain only!");
                 return;
             }
-            // ROS_INFO_STREAM("Calculated twist for frame: " << frame_number);
 
-            KDL::Twist twist = frame_vel.GetTwist();  // predicted frame twist
+            const KDL::Twist twist_current = frame_vel_current.GetTwist();
+            const KDL::Twist twist_predicted = frame_vel_predicted.GetTwist();
+            KDL::Vector pred_point;
+            tf::vectorEigenToKDL(critical_data.nearest_point_frame_vector, pred_point);
+            Eigen::Vector3d pred_pos;
 
-            Eigen::Vector3d pred_twist_vel;
-            tf::vectorKDLToEigen(twist.vel, pred_twist_vel);
+            const ros::WallTime steps_start = ros::WallTime::now();
+            for (uint16_t step = 1; step <= steps; ++step)
+            {
+                const double ratio = static_cast<double>(step) / static_cast<double>(steps);
+                const KDL::Twist twist = twist_current * (1.0 - ratio) + twist_predicted * ratio;  // predicted frame twist
 
-            Eigen::Vector3d pred_twist_rot;
-            tf::vectorKDLToEigen(twist.rot, pred_twist_rot);
+                pred_point = KDL::addDelta(pred_point, twist.vel + twist.rot * pred_point, cycle);
+                tf::vectorKDLToEigen(pred_point, pred_pos);
 
-            std::vector<ObstacleDistanceData>::const_iterator it = this->constraint_params_.current_distances_.begin();
-            ObstacleDistanceData critical_data = *it;
-            for ( ; it != this->constraint_params_.current_distances_.end(); ++it)
-            {
-                if (it->min_distance < critical_data.min_distance)
+                const double pred_dist = (critical_data.nearest_point_obstacle_vector - pred_pos).norm();
+                if (pred_dist < this->prediction_value_)
                 {
-                    critical_data = *it;
+                    this->prediction_value_ = pred_dist;
                 }
             }
 
-            Eigen::Vector3d delta_pred_vel = pred_twist_vel + pred_twist_rot.cross(critical_data.nearest_point_frame_vector);
-            Eigen::Vector3d pred_pos = critical_data.nearest_point_frame_vector + delta_pred_vel * cycle;
-            this->prediction_value_ = (critical_data.nearest_point_obstacle_vector - pred_pos).norm();
+            this->prediction_duration_ = (ros::WallTime::now() - steps_start).toSec();
         }
     }
     else
@@ -0,0 +1,106 @@
+/*
+ * Copyright 2017 Fraunhofer Institute for Manufacturing Engineering and Automation (IPA)
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef COB_TWIST_CONTROLLER_UTILS_LOOKAHEAD_PREDICTOR_H
+#define COB_TWIST_CONTROLLER_UTILS_LOOKAHEAD_PREDICTOR_H
+
+#include <stdint.h>
+#include <cmath>
+#include <algorithm>
+#include <Eigen/Core>
+#include <kdl/jntarrayvel.hpp>
+
+#include "cob_twist_controller/cob_twist_controller_data_types.h"
+#include "cob_twist_controller/utils/moving_average.h"
+
+#define LOOKAHEAD_SLACK_RATIO 0.5   /// share of the measured solver slack that may be spent on the lookahead
+
+/**
+ * Rolls the particular solution forward over a horizon of several solver cycles.
+ * The number of steps is adapted every cycle from the measured cost of one lookahead step,
+ * such that the additional compute fits into a fixed budget and into the remaining slack of the cycle.
+ */
+class LookaheadPredictor
+{
+    public:
+        explicit LookaheadPredictor(double smoothing = 0.2)
+        : step_cost_(smoothing),
+          steps_(1)
+        {}
+
+        inline uint16_t getSteps() const
+        {
+            return this->steps_;
+        }
+
+        /**
+         * Predicts the joint states at the end of the current horizon.
+         * As the particular solution is constant over the horizon, the joint positions move linearly.
+         * @param joint_states The current joint states.
+         * @param particular_solution The joint velocities of the particular solution.
+         * @param cycle The duration of one solver cycle in [s].
+         * @param prediction The predicted joint positions at the end of the horizon and the joint velocities.
+         */
+        void predict(const JointStates& joint_states,
+                     const Eigen::MatrixXd& particular_solution,
+                     double cycle,
+                     KDL::JntArrayVel& prediction) const
+        {
+            const double horizon = static_cast<double>(this->steps_) * cycle;
+            for (int i = 0; i < joint_states.current_q_.rows(); ++i)
+            {
+                prediction.q(i) = particular_solution(i, 0) * horizon + joint_states.current_q_(i);
+                prediction.qdot(i) = particular_solution(i, 0);
+            }
+        }
+
+        /**
+         * Chooses the number of steps for the next cycle.
+         * @param steps_duration Measured duration of the lookahead steps of all constraints in [s].
+         *                       The FK and Jacobian updates are left out, as their cost does not depend on the number of steps.
+         * @param solve_duration Measured duration of the whole solve step in [s].
+         * @param cycle The duration of one solver cycle in [s].
+         * @param max_steps Upper bound for the number of steps (1 disables the lookahead).
+         * @param budget Fixed upper bound for the lookahead compute per cycle in [s].
+         */
+        void adapt(double steps_duration,
+                   double solve_duration,
+                   double cycle,
+                   uint16_t max_steps,
+                   double budget)
+        {
+            this->step_cost_.addElement(steps_duration / static_cast<double>(this->steps_));
+
+            double step_cost;
+            if (max_steps <= 1 || !this->step_cost_.calcMovingAverage(step_cost) || step_cost < ZERO_THRESHOLD)
+            {
+                this->steps_ = 1;
+                return;
+            }
+
+            const double slack = cycle - (solve_duration - steps_duration);
+            const double available = std::min(budget, LOOKAHEAD_SLACK_RATIO * slack);
+            const double steps = std::floor(available / step_cost);
+            this->steps_ = static_cast<uint16_t>(std::max(1.0, std::min(static_cast<double>(max_steps), steps)));
+        }
+
+    private:
+        MovingAvgExponential_double_t step_cost_;
+        uint16_t steps_;
+};
+
+#endif  // COB_TWIST_CONTROLLER_UTILS_LOOKAHEAD_PREDICTOR_H
@@ -66,6 +66,69 @@ void CallbackDataMediator::distancesToObstaclesCallback(const cob_control_msgs::
         tf::vectorMsgToEigen(it->frame_vector, d.frame_vector);
         tf::vectorMsgToEigen(it->nearest_point_frame_vector, d.nearest_point_frame_vector);
         tf::vectorMsgToEigen(it->nearest_point_obstacle_vector, d.nearest_point_obstacle_vector);
+        d.contact_predicted = it->contact_predicted;
+        d.time_to_contact = it->time_to_contact;
         this->obstacle_distances_[it->link_of_interest].push_back(d);
     }
 }
+
+/// Name table for the indices of the compact distances
+void CallbackDataMediator::distanceNamesCallback(const cob_control_msgs::ObstacleDistanceNames::ConstPtr& msg)
+{
+    boost::mutex::scoped_lock lock(distances_to_obstacles_lock_);
+    this->compact_links_ = msg->links;
+    this->compact_names_version_ = msg->version;
+    this->compact_names_valid_ = true;
+}
+
+/// Producer: Applies the changes of the compact distances and fills obstacle distances again
+void CallbackDataMediator::compactDistancesToObstaclesCallback(const cob_control_msgs::CompactObstacleDistances::ConstPtr& msg)
+{
+    boost::mutex::scoped_lock lock(distances_to_obstacles_lock_);
+    if (!this->compact_names_valid_ || msg->names_version != this->compact_names_version_)
+    {
+        // the indices refer to a name table that has not been received (yet): keep the last distances
+        this->compact_synced_ = false;
+        return;
+    }
+
+    if (msg->keyframe)
+    {
+        this->compact_distances_.clear();
+        this->compact_synced_ = true;
+    }
+    else if (!this->compact_synced_ || msg->sequence != this->compact_sequence_ + 1)
+    {
+        // a delta has been lost: keep the last distances until the next keyframe
+        this->compact_synced_ = false;
+        return;
+    }
+
+    this->compact_sequence_ = msg->sequence;
+
+    for (uint32_t i = 0; i < msg->released_link_indices.size() && i < msg->released_obstacle_indices.size(); ++i)
+    {
+        this->compact_distances_.erase((static_cast<uint32_t>(msg->released_link_indices[i]) << 16) | msg->released_obstacle_indices[i]);
+    }
+
+    for (cob_control_msgs::CompactObstacleDistances::_distances_type::const_iterator it = msg->distances.begin(); it != msg->distances.end(); it++)
+    {
+        ObstacleDistanceData& d = this->compact_distances_[(static_cast<uint32_t>(it->link_index) << 16) | it->obstacle_index];
+        d.min_distance = it->distance;
+        d.frame_vector << it->frame_vector[0], it->frame_vector[1], it->frame_vector[2];
+        d.nearest_point_frame_vector << it->nearest_point_frame_vector[0], it->nearest_point_frame_vector[1], it->nearest_point_frame_vector[2];
+        d.nearest_point_obstacle_vector << it->nearest_point_obstacle_vector[0], it->nearest_point_obstacle_vector[1], it->nearest_point_obstacle_vector[2];
+        d.contact_predicted = it->contact_predicted;
+        d.time_to_contact = it->time_to_contact;
+    }
+
+    this->obstacle_distances_.clear();
+    for (std::map<uint32_t, ObstacleDistanceData>::const_iterator it = this->compact_distances_.begin(); it != this->compact_distances_.end(); ++it)
+    {
+        const uint32_t link_index = it->first >> 16;
+        if (link_index < this->compact_links_.size())
+        {
+            this->obstacle_distances_[this->compact_links_[link_index]].push_back(it->second);
+        }
+    }
+}
@@ -188,7 +188,19 @@ bool CobTwistController::initialize()
     ros::Duration(1.0).sleep();
 
     /// initialize ROS interfaces
-    obstacle_distance_sub_ = nh_.subscribe("obstacle_distance", 1, &CallbackDataMediator::distancesToObstaclesCallback, &callback_data_mediator_);
+    /// exactly one distance input, both would rebuild the obstacle distances of the mediator in turn
+    bool compact_obstacle_distance;
+    nh_twist.param<bool>("compact_obstacle_distance", compact_obstacle_distance, false);
+    if (compact_obstacle_distance)
+    {
+        obstacle_distance_names_sub_ = nh_.subscribe("obstacle_distance/names", 1, &CallbackDataMediator::distanceNamesCallback, &callback_data_mediator_);
+        compact_obstacle_distance_sub_ = nh_.subscribe("obstacle_distance/compact", 10, &CallbackDataMediator::compactDistancesToObstaclesCallback, &callback_data_mediator_);
+    }
+    else
+    {
+        obstacle_distance_sub_ = nh_.subscribe("obstacle_distance", 1, &CallbackDataMediator::distancesToObstaclesCallback, &callback_data_mediator_);
+    }
+
     jointstate_sub_ = nh_.subscribe("joint_states", 1, &CobTwistController::jointstateCallback, this);
     twist_sub_ = nh_twist.subscribe("command_twist", 1, &CobTwistController::twistCallback, this);
     twist_stamped_sub_ = nh_twist.subscribe("command_twist_stamped", 1, &CobTwistController::twistStampedCallback, this);
@@ -27,6 +27,7 @@ Eigen::MatrixXd StackOfTasksSolver::solve(const Vector6d_t& in_cart_velocities,
     ros::Time now = ros::Time::now();
     double cycle = (now - this->last_time_).toSec();
     this->last_time_ = now;
+    ros::WallTime solve_start = ros::WallTime::now();
 
     Eigen::MatrixXd damped_pinv = pinv_calc_.calculate(this->params_, this->damping_, this->jacobian_data_);
     Eigen::MatrixXd pinv = pinv_calc_.calculate(this->jacobian_data_);
@@ -44,18 +45,18 @@ Eigen::MatrixXd StackOfTasksSolver::solve(const Vector6d_t& in_cart_velocities,
 
     KDL::JntArrayVel predict_jnts_vel(joint_states.current_q_.rows());
 
-    // predict next joint states!
-    for (int i = 0; i < joint_states.current_q_.rows(); ++i)
-    {
-        predict_jnts_vel.q(i) = particular_solution(i, 0) * cycle + joint_states.current_q_(i);
-        predict_jnts_vel.qdot(i) = particular_solution(i, 0);
-    }
+    // predict joint states at the end of the lookahead horizon!
+    const uint16_t prediction_steps = this->lookahead_predictor_.getSteps();
+    this->lookahead_predictor_.predict(joint_states, particular_solution, cycle, predict_jnts_vel);
 
     // First iteration: update constraint state and calculate the according GPM weighting (DANGER state)
     double inv_sum_of_prionums = 0.0;
+    double steps_duration = 0.0;
     for (std::set<ConstraintBase_t>::iterator it = this->constraints_.begin(); it != this->constraints_.end(); ++it)
     {
+        (*it)->setPredictionSteps(prediction_steps);
         (*it)->update(joint_states, predict_jnts_vel, this->jacobian_data_);
+        steps_duration += (*it)->getPredictionDuration();
         const double constr_prio = (*it)->getPriorityAsNum();
         if ((*it)->getState().getCurrent() == DANGER)
         {
@@ -98,6 +99,14 @@ Eigen::MatrixXd StackOfTasksSolver::solve(const Vector6d_t& in_cart_velocities,
     }
 
     qdots_out.col(0) = q_i + projector_i * sum_of_gradient;
+
+    // choose the lookahead horizon for the next cycle from the measured costs
+    const double solve_duration = (ros::WallTime::now() - solve_start).toSec();
+    this->lookahead_predictor_.adapt(steps_duration,
+                                     solve_duration,
+                                     cycle,
+                                     this->params_.prediction_horizon,
+                                     this->params_.prediction_budget);
     return qdots_out;
 }
 